@@ -0,0 +1,286 @@
+#include "heat.h"
+
+extern char const *runame;
+extern int noout;
+extern int insiti;
+extern Number lenx;
+
+// In-situ analysis reduces the solution at every step to a few time series,
+// written as .curve files of time and value, instead of saving all of it.
+// Each stage of insitu="stage;stage;..." adds one or more series...
+//     probe(X0,X1,...)      temperature at each x=Xi
+//     stats                 min, max and mean temperature over [0,lenx]
+//     cross(X0,T0,X1,T1...) time at which temperature at x=Xi first crosses Ti
+typedef enum
+{
+    SERIES_PROBE,
+    SERIES_MIN,
+    SERIES_MAX,
+    SERIES_MEAN,
+    SERIES_CROSS
+} series_kind_t;
+
+typedef struct
+{
+    series_kind_t kind;
+    Number x;         // position of a probe or crossing
+    Number thresh;    // threshold of a crossing
+    Number last;      // value at the last step, for a crossing
+    Number tcross;    // time of a crossing, <0 until it happens
+    FILE *outf;
+} series_t;
+
+static int       nseries = 0;
+static int       maxseries = 0;
+static series_t *series = 0;
+static int       need_stats = 0;
+static Number    last_t = 0;
+
+static series_t *
+add_series(series_kind_t kind, Number x, Number thresh)
+{
+    series_t *s;
+
+    if (x < 0 || x > lenx)
+    {
+        fprintf(stderr, "In-situ analysis at x=%g is outside [0,%g]\n", (double) x, (double) lenx);
+        exit(1);
+    }
+    if (nseries == maxseries)
+    {
+        maxseries = 2 * maxseries + 4;
+        series = (series_t*) realloc(series, maxseries * sizeof(series_t));
+    }
+
+    s = &series[nseries++];
+    memset(s, 0, sizeof(*s));
+    s->kind = kind;
+    s->x = x;
+    s->thresh = thresh;
+    s->tcross = -1;
+    return s;
+}
+
+// Open <runame>/<runame>_<name>.curve for writing
+static FILE *
+open_curve(char const *name)
+{
+    char fname[256];
+    FILE *outf;
+
+    if (snprintf(fname, sizeof(fname), "%s/%s_%s.curve", runame, runame, name) >= (int) sizeof(fname) ||
+        !(outf = fopen(fname, "w")))
+    {
+        fprintf(stderr, "Unable to open in-situ analysis file for \"%s\"\n", name);
+        exit(1);
+    }
+    return outf;
+}
+
+static void
+open_series(series_t *s, char const *name)
+{
+    if (noout) return;
+
+    s->outf = open_curve(name);
+    fprintf(s->outf, "# %s\n", name);
+}
+
+static void
+malformed_stage(char const *p)
+{
+    fprintf(stderr, "Malformed in-situ analysis stage \"%s\"\n", p);
+    exit(1);
+}
+
+// Parse the next stage of insitu, returning a pointer past it
+static char const *
+parse_stage(char const *p)
+{
+    char *q;
+    char name[64];
+
+    if (!strncmp(p, "probe(", 6))
+    {
+        q = (char*) p+5;
+        do
+        {
+            series_t *s = add_series(SERIES_PROBE, strtod(q+1, &q), 0);
+            snprintf(name, sizeof(name), "probe_%g", (double) s->x);
+            open_series(s, name);
+        } while (*q == ',');
+        if (*q++ != ')')
+            malformed_stage(p);
+    }
+    else if (!strncmp(p, "stats", 5))
+    {
+        q = (char*) p+5;
+        open_series(add_series(SERIES_MIN, 0, 0), "min");
+        open_series(add_series(SERIES_MAX, 0, 0), "max");
+        open_series(add_series(SERIES_MEAN, 0, 0), "mean");
+        need_stats = 1;
+    }
+    else if (!strncmp(p, "cross(", 6))
+    {
+        q = (char*) p+5;
+        do
+        {
+            Number const x = strtod(q+1, &q);
+            if (*q != ',')
+                malformed_stage(p);
+            add_series(SERIES_CROSS, x, strtod(q+1, &q));
+        } while (*q == ',');
+        if (*q++ != ')')
+            malformed_stage(p);
+    }
+    else
+    {
+        fprintf(stderr, "Unrecognized in-situ analysis stage \"%s\"\n", p);
+        exit(1);
+    }
+
+    if (*q && *q != ';')
+        malformed_stage(p);
+    return *q ? q+1 : q;
+}
+
+// Linearly interpolate the value at xp from the samples u at x
+static Number
+value_at(int n, Number const *x, Number const *u, Number xp)
+{
+    int lo = 0, hi = n-1;
+
+    while (hi - lo > 1)
+    {
+        int const mid = (lo + hi) / 2;
+        if (x[mid] <= xp) lo = mid;
+        else              hi = mid;
+    }
+    return u[lo] + (u[hi] - u[lo]) * (xp - x[lo]) / (x[hi] - x[lo]);
+}
+
+// Min, max and mean, by the trapezoid rule so that it holds on any grid,
+// in one pass over the solution
+static void
+reduce_stats(int n, Number const *x, Number const *u,
+    Number *umin, Number *umax, Number *umean)
+{
+    int i;
+    Number lo = u[0], hi = u[0], sum = 0;
+
+    #pragma omp parallel for reduction(min:lo) reduction(max:hi) reduction(+:sum)
+    for (i = 1; i < n; i++)
+    {
+        Number const ui = u[i];
+        lo = ui < lo ? ui : lo;
+        hi = ui > hi ? ui : hi;
+        sum += (u[i-1] + ui) * (x[i] - x[i-1]);
+    }
+
+    *umin = lo;
+    *umax = hi;
+    *umean = sum / (2 * (x[n-1] - x[0]));
+}
+
+static void
+record(series_t *s, Number t, Number v)
+{
+    if (s->outf)
+        fprintf(s->outf, FPFMT " " FPFMT "\n", (FPCAST) t, (FPCAST) v);
+}
+
+// Reduce the solution, u, on the points, x, at time t, writing the time
+// series if ti is 0 or a multiple of insiti. Only crossings, which need
+// just the value at a point, are tested at every step.
+void
+update_analysis(int ti, Number t, int n, Number const *x, Number const *u)
+{
+    int i;
+    int const write = ti == 0 || (insiti && ti%insiti==0);
+    Number umin = 0, umax = 0, umean = 0;
+
+    if (need_stats && write)
+        reduce_stats(n, x, u, &umin, &umax, &umean);
+
+    for (i = 0; i < nseries; i++)
+    {
+        series_t *s = &series[i];
+
+        switch (s->kind)
+        {
+            case SERIES_PROBE: if (write) record(s, t, value_at(n, x, u, s->x)); break;
+            case SERIES_MIN:   if (write) record(s, t, umin); break;
+            case SERIES_MAX:   if (write) record(s, t, umax); break;
+            case SERIES_MEAN:  if (write) record(s, t, umean); break;
+            case SERIES_CROSS:
+            {
+                Number v;
+                if (s->tcross >= 0)
+                    break;
+                v = value_at(n, x, u, s->x);
+                if (t > last_t && (s->last - s->thresh) * (v - s->thresh) <= 0 && v != s->last)
+                    s->tcross = last_t + (t - last_t) * (s->thresh - s->last) / (v - s->last);
+                s->last = v;
+                break;
+            }
+        }
+    }
+    last_t = t;
+}
+
+// Set up the stages of insitu and record the initial condition, u, at t=0
+void
+initialize_analysis(char const *insitu, int n, Number const *x, Number const *u)
+{
+    char const *p = insitu;
+
+    if (!strncmp(insitu, "none", 4))
+        return;
+
+    while (*p)
+        p = parse_stage(p);
+
+    update_analysis(0, 0, n, x, u);
+}
+
+// Report crossings, to stdout and as a curve of crossing time by x, and
+// close all the time series
+void
+finalize_analysis(void)
+{
+    int i;
+    FILE *outf = 0;
+
+    for (i = 0; i < nseries; i++)
+    {
+        series_t *s = &series[i];
+
+        if (s->outf)
+            fclose(s->outf);
+        if (s->kind != SERIES_CROSS)
+            continue;
+
+        if (s->tcross < 0)
+        {
+            printf("Temperature at x=%g did not cross %g\n", (double) s->x, (double) s->thresh);
+            continue;
+        }
+        printf("Temperature at x=%g crossed %g at t=%g\n",
+            (double) s->x, (double) s->thresh, (double) s->tcross);
+
+        if (!outf && !noout)
+        {
+            outf = open_curve("cross");
+            fprintf(outf, "# cross\n");
+        }
+        if (outf)
+            fprintf(outf, FPFMT " " FPFMT "\n", (FPCAST) s->x, (FPCAST) s->tcross);
+    }
+    if (outf)
+        fclose(outf);
+
+    free(series);
+    series = 0;
+    nseries = maxseries = 0;
+    need_stats = 0;
+}
@@ -0,0 +1,101 @@
+#include <sys/mman.h>
+
+#include "heat.h"
+
+// All solver arrays are carved from a single region so that they are
+// contiguous, 64-byte (cache line and widest vector load) aligned and
+// optionally backed by huge pages to reduce TLB pressure for large Nx.
+#define ARENA_ALIGN 64
+#define ARENA_HUGEPAGE (2*1024*1024)
+
+static char  *arena_base   = 0;
+static size_t arena_size   = 0;
+static size_t arena_used   = 0;
+static int    arena_mmaped = 0;
+
+// Bytes an allocation of nbytes will actually occupy in the arena. Every
+// array is padded out to a whole number of cache lines so that no two arrays
+// share a line, and hence threads writing the last OpenMP chunk of one array
+// never false-share with threads reading the first chunk of the next.
+size_t
+arena_bytes(size_t nbytes)
+{
+    return (nbytes + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+// hugepg: 0=normal pages, 1=transparent huge pages (advisory),
+// 2=explicit huge pages (falls back to transparent if none are reserved)
+void
+arena_create(size_t nbytes, int hugepg)
+{
+    assert(!arena_base);
+
+    arena_size = arena_bytes(nbytes);
+    arena_used = 0;
+
+#ifdef MAP_HUGETLB
+    if (hugepg > 1)
+    {
+        size_t const mapsize = (arena_size + ARENA_HUGEPAGE - 1) & ~((size_t) ARENA_HUGEPAGE - 1);
+        void *p = mmap(0, mapsize, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            arena_base = (char*) p;
+            arena_size = mapsize;
+            arena_mmaped = 1;
+            return;
+        }
+        fprintf(stderr, "No explicit huge pages available, using transparent huge pages\n");
+    }
+#endif
+
+    if (hugepg > 0)
+    {
+        // Align to the huge page size so the kernel can back it with huge pages
+        size_t const mapsize = (arena_size + ARENA_HUGEPAGE - 1) & ~((size_t) ARENA_HUGEPAGE - 1);
+        if (posix_memalign((void**) &arena_base, ARENA_HUGEPAGE, mapsize))
+            arena_base = 0;
+        else
+            arena_size = mapsize;
+#ifdef MADV_HUGEPAGE
+        if (arena_base)
+            madvise(arena_base, arena_size, MADV_HUGEPAGE);
+#endif
+    }
+    else if (posix_memalign((void**) &arena_base, ARENA_ALIGN, arena_size))
+    {
+        arena_base = 0;
+    }
+
+    if (!arena_base)
+    {
+        fprintf(stderr, "Unable to allocate %zu bytes for solver arrays\n", arena_size);
+        exit(1);
+    }
+}
+
+void *
+arena_alloc(size_t nbytes)
+{
+    char *p = arena_base + arena_used;
+
+    arena_used += arena_bytes(nbytes);
+    assert(arena_used <= arena_size);
+
+    return p;
+}
+
+void
+arena_destroy(void)
+{
+    if (arena_mmaped)
+        munmap(arena_base, arena_size);
+    else
+        free(arena_base);
+
+    arena_base = 0;
+    arena_size = 0;
+    arena_used = 0;
+    arena_mmaped = 0;
+}
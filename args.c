@@ -81,14 +81,24 @@ extern Number maxt;
 extern Number bc0;
 extern Number bc1;
 extern Number min_change;
+extern Number compress;
 extern char const *runame;
 extern char const *ic;
 extern char const *alg;
+extern char const *grid;
+extern char const *alphax;
+extern char const *insitu;
 extern int savi;
 extern int save;
 extern int outi;
 extern int noout;
+extern int binout;
 extern int nt;
+extern int hugepg;
+extern int order;
+extern int lts;
+extern int chki;
+extern int insiti;
 int const prec = FPTYPE;
 
 static void handle_help(char const *argv0)
@@ -96,6 +106,7 @@ static void handle_help(char const *argv0)
     fprintf(stderr, "Examples...\n");
     fprintf(stderr, "    %s dx=0.01 dt=0.0002 alg=ftcs\n", argv0);
     fprintf(stderr, "    %s dx=0.1 bc0=273 bc1=273 ic=\"spikes(273,5,373)\"\n", argv0);
+    fprintf(stderr, "    %s dx=0.01 grid=\"cluster(0.5,4)\" lts=1 ic=\"spikes(0,100,50)\"\n", argv0);
     fprintf(stderr, "    %s ic=\"help\" to get help on initial condition options\n", argv0);
 }
 
@@ -109,6 +120,7 @@ static void handle_ic_help()
     fprintf(stderr, "    ic=\"sin(A,w)\" a sin wave with amplitude A and frequency w\n");
     fprintf(stderr, "    ic=\"spikes(C,A0,X0,A1,X1,...)\" a constant value, C with spikes of amplitude Ai at position Xi\n");
     fprintf(stderr, "    ic=\"file(foo.dat)\" : read initial condition data from the file foo.dat\n");
+    fprintf(stderr, "        foo.dat may be whitespace separated text or a .bin file written with binout=1\n");
     fprintf(stderr,
         "Be sure to use double-quotes (\") as shown and you may also need to set boundary"
         "\nconditions such that they *combine* smoothly with the initial condition.\n");
@@ -129,15 +141,20 @@ process_args(int argc, char **argv)
         fprintf(stderr, "Usage: %s <arg>=<value> <arg>=<value>...\n", argv[0]);
 
     HANDLE_FARG(alpha, material thermal diffusivity (sq-meters/second));
+    HANDLE_SARG(alphax, diffusivity by x uniform|layers(A0,X1,A1,...)|file(foo.dat));
     HANDLE_FARG(lenx, material length (meters));
     HANDLE_FARG(dx, x-incriment. Best if lenx/dx==int. (meters));
     HANDLE_FARG(dt, t-incriment (seconds));
     HANDLE_FARG(maxt, >0:max sim time (seconds) | <0:min l2 change in soln);
+    HANDLE_IARG(chki, for maxt<0 check change every i-th step | >1 predicts when);
     HANDLE_FARG(bc0, boundary condition @ x=0: u(0,t) (Kelvin));
     HANDLE_FARG(bc1, boundary condition @ x=lenx: u(lenx,t) (Kelvin));
     HANDLE_SARG(runame, name to give run and results dir);
     HANDLE_SARG(ic, initial condition @ t=0: u(x,0) (Kelvin));
     HANDLE_SARG(alg, algorithm ftcs|dufrank|crankn);
+    HANDLE_IARG(order, spatial order of accuracy 2|4|6);
+    HANDLE_SARG(grid, x sample points uniform|cluster(Xc,S)|adapt(K,B));
+    HANDLE_IARG(lts, local time stepping for ftcs on nonuniform grids);
 #ifdef _OPENMP
     HANDLE_IARG(nt, number of parallel tasks);
 #else
@@ -145,9 +162,14 @@ process_args(int argc, char **argv)
     nt = 0;
 #endif
     HANDLE_IARG(savi, save every i-th solution step);
+    HANDLE_SARG(insitu, in-situ analysis none|probe(X0,...);stats;cross(X0,T0,...));
+    HANDLE_IARG(insiti, write in-situ analysis every i-th solution step);
     HANDLE_IARG(save, save error in every saved solution);
     HANDLE_IARG(outi, output progress every i-th solution step);
     HANDLE_IARG(noout, disable all file outputs);
+    HANDLE_IARG(binout, also write solutions in binary for ic=file());
+    HANDLE_FARG(compress, >0:write solutions as .heatz to within this error);
+    HANDLE_IARG(hugepg, huge pages for arrays 0=none|1=transparent|2=explicit);
     HANDLE_IARG(prec, precision 1=float/2=double/3=long double)
 
     if (help)
@@ -162,6 +184,24 @@ process_args(int argc, char **argv)
     if (help)
         exit(1);
 
+    if (order != 2 && order != 4 && order != 6)
+    {
+        fprintf(stderr, "The spatial order must be 2, 4 or 6\n");
+        exit(1);
+    }
+
+    if ((strncmp(grid, "uniform", 7) || strncmp(alphax, "uniform", 7) || lts) && order != 2)
+    {
+        fprintf(stderr, "Nonuniform grids and diffusivity support only order=2\n");
+        exit(1);
+    }
+
+    if (lts && strcmp(alg, "ftcs"))
+    {
+        fprintf(stderr, "Local time stepping applies only to the \"ftcs\" algorithm\n");
+        exit(1);
+    }
+
     // Handle possible invalid combination of parallel tasking and algorithm
 #ifdef _OPENMP
     if (nt > 1 && !strcmp(alg,"crankn"))
@@ -171,6 +211,12 @@ process_args(int argc, char **argv)
     } 
 #endif 
 
+    if (compress < 0)
+    {
+        fprintf(stderr, "The compression error bound must be positive\n");
+        exit(1);
+    }
+
     // Handle possible termination by change threshold criterion
     if (maxt < 0)
     {
@@ -0,0 +1,338 @@
+#include "heat.h"
+
+// Compressed solution files hold each value to within an absolute error
+// bound, E. Every value is predicted by linear extrapolation from the two
+// values before it, as they will be reconstructed, and the difference is
+// quantized to a multiple of 2E. Smooth solutions are predicted well so
+// most multiples are zero and runs of them take a byte or two. Values are
+// compressed in independent blocks, in parallel, and each block is a
+// stream of varint codes...
+//     0         escape, the value follows as a raw double
+//     odd c     a run of c>>1 values with zero multiples
+//     even c>0  a nonzero multiple, q, where c>>1 is zigzag(q)
+#define HEATZ_MAGIC "HEATZ001"
+#define HEATZ_BLOCK 4096
+#define HEATZ_MAXQ (1LL<<40)
+typedef struct _heatz_header_t
+{
+    char magic[8];
+    int  nbytes;     // sizeof(Number) of the writer
+    int  uniform;    // x is i*dx, else the n values of x follow this header
+    long long n;     // number of values
+    double errbnd;   // absolute error bound, E
+    double dx;
+    int  blocksize;
+    int  nblocks;    // nblocks block sizes then the blocks follow the x
+} heatz_header_t;
+
+static unsigned char *
+put_varint(unsigned char *p, unsigned long long c)
+{
+    while (c >= 0x80)
+    {
+        *p++ = (unsigned char) (c | 0x80);
+        c >>= 7;
+    }
+    *p++ = (unsigned char) c;
+    return p;
+}
+
+// Returns null if the varint runs past end
+static unsigned char const *
+get_varint(unsigned char const *p, unsigned char const *end, unsigned long long *c)
+{
+    int shift = 0;
+
+    *c = 0;
+    do
+    {
+        if (p == end || shift > 63)
+            return 0;
+        *c |= (unsigned long long) (*p & 0x7F) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    return p;
+}
+
+// Prediction of the next value from the last two, r1 and r2, reconstructed
+// values. Shared by compression and decompression so both round the same.
+static double
+predict(int i, double r1, double r2)
+{
+    return i > 1 ? 2*r1 - r2 : (i ? r1 : 0);
+}
+
+static double
+reconstruct(double pred, double e2, long long q)
+{
+    return pred + e2 * (double) q;
+}
+
+// Compress the n values, a, to out which must hold 9n+10 bytes. Returns
+// the number of bytes written.
+static size_t
+compress_block(int n, Number const *a, double errbnd, unsigned char *out)
+{
+    int i;
+    unsigned char *p = out;
+    double const e2 = 2 * errbnd;
+    double r1 = 0, r2 = 0;
+    unsigned long long run = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        double const u = (double) a[i];
+        double const pred = predict(i, r1, r2);
+        double const qd = nearbyint((u - pred) / e2);
+        long long const q = fabs(qd) < HEATZ_MAXQ ? (long long) qd : 0;
+        double r = reconstruct(pred, e2, q);
+
+        if (q == 0 && fabs(u - r) <= errbnd)
+        {
+            run++;
+        }
+        else
+        {
+            if (run)
+                p = put_varint(p, 2*run+1);
+            run = 0;
+
+            if (fabs(qd) < HEATZ_MAXQ && fabs(u - r) <= errbnd)
+            {
+                unsigned long long const zz = q < 0 ? 2*(unsigned long long)(-q)-1 : 2*(unsigned long long)q;
+                p = put_varint(p, 2*zz);
+            }
+            else
+            {
+                r = u;
+                p = put_varint(p, 0);
+                memcpy(p, &r, sizeof(r));
+                p += sizeof(r);
+            }
+        }
+
+        r2 = r1;
+        r1 = r;
+    }
+    if (run)
+        p = put_varint(p, 2*run+1);
+
+    return p - out;
+}
+
+// Decompress n values to a from the block from p to end. Returns 0 if the
+// block ends before all n values.
+static int
+decompress_block(int n, unsigned char const *p, unsigned char const *end,
+    double errbnd, Number *a)
+{
+    int i = 0;
+    double const e2 = 2 * errbnd;
+    double r1 = 0, r2 = 0;
+
+    while (i < n)
+    {
+        unsigned long long c, run = 1;
+        long long q = 0;
+        double r = 0;
+
+        p = get_varint(p, end, &c);
+        if (!p)
+            return 0;
+        if (c == 0)
+        {
+            if (end - p < (long) sizeof(r))
+                return 0;
+            memcpy(&r, p, sizeof(r));
+            p += sizeof(r);
+        }
+        else if (c & 1)
+        {
+            run = c >> 1;
+        }
+        else
+        {
+            unsigned long long const zz = c >> 1;
+            q = zz & 1 ? -(long long) ((zz+1) >> 1) : (long long) (zz >> 1);
+        }
+
+        for (; run && i < n; run--, i++)
+        {
+            if (c)
+                r = reconstruct(predict(i, r1, r2), e2, q);
+            a[i] = (Number) r;
+            r2 = r1;
+            r1 = r;
+        }
+    }
+
+    return 1;
+}
+
+// Write the n values, a, at x (or i*dx if x is null) to fname, each to
+// within errbnd. Blocks are compressed in batches of one per thread into
+// per-thread buffers and written in order, with their sizes filled in last.
+void
+write_compressed(char const *fname, int n, Number const *x, Number dx,
+    Number const *a, Number errbnd)
+{
+    heatz_header_t hdr;
+    int b, b0, i;
+    int const nblocks = (n + HEATZ_BLOCK - 1) / HEATZ_BLOCK;
+    size_t const maxbytes = 9 * HEATZ_BLOCK + 10;
+#ifdef _OPENMP
+    int const nbufs = omp_get_max_threads();
+#else
+    int const nbufs = 1;
+#endif
+    unsigned char *bufs = (unsigned char *) malloc(nbufs * maxbytes);
+    unsigned int *sizes = (unsigned int *) calloc(nblocks, sizeof(unsigned int));
+    long sizes_at;
+    FILE *outf;
+
+    if (!bufs || !sizes)
+    {
+        fprintf(stderr, "Unable to allocate buffers to compress \"%s\"\n", fname);
+        exit(1);
+    }
+
+    outf = fopen(fname, "wb");
+    if (!outf)
+    {
+        fprintf(stderr, "Unable to open \"%s\" for writing\n", fname);
+        exit(1);
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, HEATZ_MAGIC, sizeof(hdr.magic));
+    hdr.nbytes = (int) sizeof(Number);
+    hdr.uniform = x == 0;
+    hdr.n = n;
+    hdr.errbnd = (double) errbnd;
+    hdr.dx = (double) dx;
+    hdr.blocksize = HEATZ_BLOCK;
+    hdr.nblocks = nblocks;
+
+    fwrite(&hdr, sizeof(hdr), 1, outf);
+    for (i = 0; x && i < n; i++)
+    {
+        double const xi = (double) x[i];
+        fwrite(&xi, sizeof(xi), 1, outf);
+    }
+    sizes_at = ftell(outf);
+    fwrite(sizes, sizeof(unsigned int), nblocks, outf);
+
+    for (b0 = 0; b0 < nblocks; b0 += nbufs)
+    {
+        int const b1 = b0 + nbufs < nblocks ? b0 + nbufs : nblocks;
+
+        #pragma omp parallel for schedule(dynamic)
+        for (b = b0; b < b1; b++)
+        {
+            int const m = n - b*HEATZ_BLOCK < HEATZ_BLOCK ? n - b*HEATZ_BLOCK : HEATZ_BLOCK;
+            sizes[b] = (unsigned int) compress_block(m, a + (long long) b*HEATZ_BLOCK,
+                                                     (double) errbnd, bufs + (b-b0)*maxbytes);
+        }
+
+        for (b = b0; b < b1; b++)
+            fwrite(bufs + (b-b0)*maxbytes, 1, sizes[b], outf);
+    }
+
+    fseek(outf, sizes_at, SEEK_SET);
+    fwrite(sizes, sizeof(unsigned int), nblocks, outf);
+    if (ferror(outf) | fclose(outf))
+    {
+        fprintf(stderr, "Unable to write \"%s\"\n", fname);
+        exit(1);
+    }
+
+    free(sizes);
+    free(bufs);
+}
+
+// Read a file written by write_compressed, returning its number of values
+// and allocating and filling the positions, *x, and values, *a
+int
+read_compressed(char const *fname, Number **x, Number **a)
+{
+    heatz_header_t hdr;
+    FILE *inf = fopen(fname, "rb");
+    long size;
+    unsigned char *buf, *blocks;
+    unsigned int const *sizes;
+    size_t *offsets;
+    int b, i, bad = 0;
+
+    if (!inf)
+    {
+        fprintf(stderr, "Unable to open compressed file \"%s\"\n", fname);
+        exit(1);
+    }
+    fseek(inf, 0, SEEK_END);
+    size = ftell(inf);
+    fseek(inf, 0, SEEK_SET);
+    buf = (unsigned char *) malloc(size);
+    if (size < (long) sizeof(hdr) || fread(buf, 1, size, inf) != (size_t) size ||
+        memcmp(buf, HEATZ_MAGIC, sizeof(hdr.magic)))
+    {
+        fprintf(stderr, "File \"%s\" is not a compressed solution file\n", fname);
+        exit(1);
+    }
+    fclose(inf);
+    memcpy(&hdr, buf, sizeof(hdr));
+
+    // Check the header against the file before reading the x and sizes
+    if (hdr.n < 1 || hdr.n > INT_MAX || hdr.blocksize < 1 ||
+        hdr.nblocks != (hdr.n + hdr.blocksize - 1) / hdr.blocksize ||
+        (unsigned long long) size < sizeof(hdr) + (hdr.uniform ? 0 : hdr.n * sizeof(double)) +
+                                    hdr.nblocks * sizeof(unsigned int))
+    {
+        fprintf(stderr, "Compressed file \"%s\" is corrupt or truncated\n", fname);
+        exit(1);
+    }
+
+    *x = (Number *) malloc(hdr.n * sizeof(Number));
+    *a = (Number *) malloc(hdr.n * sizeof(Number));
+
+    blocks = buf + sizeof(hdr);
+    for (i = 0; i < hdr.n; i++)
+    {
+        double xi = i * hdr.dx;
+        if (!hdr.uniform)
+            memcpy(&xi, blocks + i*sizeof(double), sizeof(double));
+        (*x)[i] = (Number) xi;
+    }
+    if (!hdr.uniform)
+        blocks += hdr.n * sizeof(double);
+    sizes = (unsigned int const *) blocks;
+    blocks += hdr.nblocks * sizeof(unsigned int);
+
+    offsets = (size_t *) malloc((hdr.nblocks+1) * sizeof(size_t));
+    offsets[0] = 0;
+    for (b = 0; b < hdr.nblocks; b++)
+        offsets[b+1] = offsets[b] + sizes[b];
+    if (blocks + offsets[hdr.nblocks] > buf + size)
+    {
+        fprintf(stderr, "Compressed file \"%s\" is corrupt or truncated\n", fname);
+        exit(1);
+    }
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:bad)
+    for (b = 0; b < hdr.nblocks; b++)
+    {
+        long long const m = hdr.n - (long long) b*hdr.blocksize;
+        bad += !decompress_block(m < hdr.blocksize ? (int) m : hdr.blocksize,
+                                 blocks + offsets[b], blocks + offsets[b+1],
+                                 hdr.errbnd, *a + (long long) b*hdr.blocksize);
+    }
+
+    if (bad)
+    {
+        fprintf(stderr, "Compressed file \"%s\" has %d corrupt blocks\n", fname, bad);
+        exit(1);
+    }
+
+    free(offsets);
+    free(buf);
+    return (int) hdr.n;
+}
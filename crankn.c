@@ -1,55 +1,108 @@
 #include "heat.h"
 
+extern void *
+arena_alloc(size_t nbytes);
+
+extern int
+laplacian_stencil(int order, Number const **c);
+
+// Element (i,j) of a band matrix of half-bandwidth h stored by columns
+// with 2h+1 entries per column. For h=1 this is the r83 layout.
+#define BAND(a, h, i, j) (a)[(i)-(j)+(h) + (j)*(2*(h)+1)]
+
 // Licensing: This code is distributed under the GNU LGPL license. 
 // Modified: 30 May 2009 Author: John Burkardt
 // Modified by Mark C. Miller, July 23, 2017
+// Generalized from tridiagonal (r83) to banded (r8cb) storage
 static void
-r83_np_fa(int n, Number *a)
+r8cb_np_fa(int n, int h, Number *a)
 {
-    int i;
+    int i, j, k;
 
-    for ( i = 1; i <= n-1; i++ )
+    for ( k = 0; k < n-1; k++ )
     {
-        assert ( a[1+(i-1)*3] != 0.0 );
+        assert ( BAND(a,h,k,k) != 0.0 );
 
-        // Store the multiplier in L.
-        a[2+(i-1)*3] = a[2+(i-1)*3] / a[1+(i-1)*3];
+        // Store the multipliers in L.
+        for ( i = k+1; i <= k+h && i < n; i++ )
+            BAND(a,h,i,k) = BAND(a,h,i,k) / BAND(a,h,k,k);
 
-        // Modify the diagonal entry in the next column.
-        a[1+i*3] = a[1+i*3] - a[2+(i-1)*3] * a[0+i*3];
+        // Modify the trailing entries within the band.
+        for ( j = k+1; j <= k+h && j < n; j++ )
+            for ( i = k+1; i <= k+h && i < n; i++ )
+                BAND(a,h,i,j) = BAND(a,h,i,j) - BAND(a,h,i,k) * BAND(a,h,k,j);
     }
 
-    assert( a[1+(n-1)*3] != 0.0 );
+    assert( BAND(a,h,n-1,n-1) != 0.0 );
 }
 
+// Build and factor the matrix into cn_Amat. On a nonuniform grid, cl and
+// cr hold the coefficients of the differences to each point's neighbors
+// (see compute_grid_coefs) and order must be 2. Otherwise they are null.
 void
-initialize_crankn(int n,
+build_crankn(int n,
     Number alpha, Number dx, Number dt,
-    Number **_cn_Amat)
+    int order, Number const *cl, Number const *cr,
+    Number *cn_Amat)
 {
-    int i;
+    int i, k;
     Number const w = alpha * dt / dx / dx;
+    Number const *c;
+    int const h = laplacian_stencil(order, &c);
 
-    // Build a tri-diagonal matrix
-    Number *cn_Amat = (Number*) malloc(3*n*sizeof(Number));
+    // Build a banded matrix, tri-diagonal for order 2
+    memset(cn_Amat, 0, (2*h+1)*n*sizeof(Number));
 
-    cn_Amat[0+0*3] = 0.0;
-    cn_Amat[1+0*3] = 1.0;
-    cn_Amat[0+1*3] = 0.0;
+    BAND(cn_Amat,h,0,0) = 1.0;
+    BAND(cn_Amat,h,n-1,n-1) = 1.0;
 
     for ( i = 1; i < n - 1; i++ )
     {
-        cn_Amat[2+(i-1)*3] =           - w;
-        cn_Amat[1+ i   *3] = 1.0 + 2.0 * w;
-        cn_Amat[0+(i+1)*3] =           - w;
+        if (cl)
+        {
+            BAND(cn_Amat,h,i,i-1) = - cl[i];
+            BAND(cn_Amat,h,i,i  ) = 1.0 + cl[i] + cr[i];
+            BAND(cn_Amat,h,i,i+1) = - cr[i];
+            continue;
+        }
+
+        BAND(cn_Amat,h,i,i) += 1.0 - w * c[0];
+        for ( k = 1; k <= h; k++ )
+        {
+            // Samples beyond the ends are odd reflections about them,
+            // u(-x) = 2u(0) - u(x), as in laplacian_at()
+            if (i-k < 0)
+            {
+                BAND(cn_Amat,h,i,0) -= 2 * w * c[k];
+                BAND(cn_Amat,h,i,k-i) += w * c[k];
+            }
+            else
+                BAND(cn_Amat,h,i,i-k) -= w * c[k];
+
+            if (i+k > n-1)
+            {
+                BAND(cn_Amat,h,i,n-1) -= 2 * w * c[k];
+                BAND(cn_Amat,h,i,2*(n-1)-(i+k)) += w * c[k];
+            }
+            else
+                BAND(cn_Amat,h,i,i+k) -= w * c[k];
+        }
     }
-        
-    cn_Amat[2+(n-2)*3] = 0.0;
-    cn_Amat[1+(n-1)*3] = 1.0;
-    cn_Amat[2+(n-1)*3] = 0.0;
 
     // Factor the matrix.
-    r83_np_fa(n, cn_Amat);
+    r8cb_np_fa(n, h, cn_Amat);
+}
+
+void
+initialize_crankn(int n,
+    Number alpha, Number dx, Number dt,
+    int order, Number const *cl, Number const *cr,
+    Number **_cn_Amat)
+{
+    int const h = order/2;
+    Number *cn_Amat = (Number*) arena_alloc((2*h+1)*n*sizeof(Number));
+
+    build_crankn(n, alpha, dx, dt, order, cl, cr, cn_Amat);
 
     // Return the generated matrix
     *_cn_Amat = cn_Amat;
@@ -58,24 +111,26 @@ initialize_crankn(int n,
 // Licensing: This code is distributed under the GNU LGPL license. 
 // Modified: 30 May 2009 Author: John Burkardt
 // Modified by Mark C. Miller, miller86@llnl.gov, July 23, 2017
+// Generalized from tridiagonal (r83) to banded (r8cb) storage
 static void 
-r83_np_sl ( int n, Number const *a_lu, Number const *b, Number *x)
+r8cb_np_sl ( int n, int h, Number const *a_lu, Number const *b, Number *x)
 {
-    int i;
+    int i, k;
 
     for ( i = 0; i < n; i++ )
         x[i] = b[i];
 
     // Solve L * Y = B.
-    for ( i = 1; i < n; i++ )
-        x[i] = x[i] - a_lu[2+(i-1)*3] * x[i-1];
+    for ( k = 0; k < n-1; k++ )
+        for ( i = k+1; i <= k+h && i < n; i++ )
+            x[i] = x[i] - BAND(a_lu,h,i,k) * x[k];
 
     // Solve U * X = Y.
-    for ( i = n; 1 <= i; i-- )
+    for ( k = n-1; 0 <= k; k-- )
     {
-        x[i-1] = x[i-1] / a_lu[1+(i-1)*3];
-        if ( 1 < i )
-            x[i-2] = x[i-2] - a_lu[0+(i-1)*3] * x[i-1];
+        x[k] = x[k] / BAND(a_lu,h,k,k);
+        for ( i = k-h < 0 ? 0 : k-h; i < k; i++ )
+            x[i] = x[i] - BAND(a_lu,h,i,k) * x[k];
     }
 }
 
@@ -83,10 +138,11 @@ int
 update_solution_crankn(int n,
     Number *curr, Number const *last,
     Number const *cn_Amat,
-    Number bc_0, Number bc_1)
+    Number bc_0, Number bc_1,
+    int order)
 {
     // Do the solve
-    r83_np_sl (n, cn_Amat, last, curr);
+    r8cb_np_sl (n, order/2, cn_Amat, last, curr);
     curr[0] = bc_0;
     curr[n-1] = bc_1;
 
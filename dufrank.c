@@ -1,5 +1,11 @@
 #include "heat.h"
 
+extern int
+laplacian_stencil(int order, Number const **c);
+
+extern Number
+laplacian_at(int n, Number const *u, int i, int h, Number const *c);
+
 int                        // 0 if unstable, 1 otherwise
 update_solution_dufrank(
     int n,                  // number of samples
@@ -8,15 +14,79 @@ update_solution_dufrank(
     Number const *uk2,      // array u(x,k-2) computed @ -2 time index ago
     Number alpha,           // thermal diffusivity
     Number dx, Number dt,   // spacing in space, x, and time, t.
-    Number bc0, Number bc1) // boundary conditions @ x=0 & x=Lx
+    Number bc0, Number bc1, // boundary conditions @ x=0 & x=Lx
+    int order)              // spatial order of accuracy, 2, 4 or 6
 {
     Number r = alpha * dt / (dx * dx);
-    Number q = 1 / (1+r);
+    Number const *c;
+    int const h = laplacian_stencil(order, &c);
+
+    if (order == 2)
+    {
+        Number q = 1 / (1+r);
+
+        // DuFort-Frankel update algorithm
+        #pragma omp parallel for
+        for (int i = 1; i < n-1; i++)
+            uk[i] = q * (1-r) * uk2[i] + q * r * (uk1[i+1] + uk1[i-1]);
+    }
+    else
+    {
+        // Only part of the center weight, s, is averaged over k and k-2 and
+        // the rest, c[0]+s, is applied at k-1. The scheme is unconditionally
+        // stable only if s is at least the sum of the off-center weights,
+        // 2*sum|c[k]|, which for the wide stencils exceeds |c[0]|. For the
+        // 3-point stencil s = -c[0] and this reduces to the above.
+        Number s = 0;
+        for (int k = 1; k <= h; k++)
+            s += 2 * fabs(c[k]);
+        Number q = 1 / (1 + r*s/2);
+
+        // DuFort-Frankel update algorithm with a wide stencil
+        #pragma omp parallel for
+        for (int i = h; i < n-h; i++)
+        {
+            Number off = (c[0] + s) * uk1[i];
+            for (int k = 1; k <= h; k++)
+                off += c[k] * (uk1[i-k] + uk1[i+k]);
+            uk[i] = q * (1 - r*s/2) * uk2[i] + q * r * off;
+        }
+
+        // points whose stencil reaches beyond the boundaries
+        for (int i = 1; i < h; i++)
+        {
+            Number offl = laplacian_at(n, uk1, i, h, c) + s * uk1[i];
+            Number offr = laplacian_at(n, uk1, n-1-i, h, c) + s * uk1[n-1-i];
+            uk[i    ] = q * (1 - r*s/2) * uk2[i    ] + q * r * offl;
+            uk[n-1-i] = q * (1 - r*s/2) * uk2[n-1-i] + q * r * offr;
+        }
+    }
+
+    // enforce boundary conditions
+    uk[0  ] = bc0;
+    uk[n-1] = bc1;
 
-    // DuFort-Frankel update algorithm
+    return 1;
+}
+
+int                        // 0 if unstable, 1 otherwise
+update_solution_dufrank_flux(
+    int n,                  // number of samples
+    Number *uk,             // new array of u(x,k) to compute/return
+    Number const *uk1,      // array u(x,k-1) computed @ -1 time index ago
+    Number const *uk2,      // array u(x,k-2) computed @ -2 time index ago
+    Number const *cl,       // coefficients of differences to left neighbors
+    Number const *cr,       // coefficients of differences to right neighbors
+    Number bc0, Number bc1) // boundary conditions @ x=0 & x=Lx
+{
+    // DuFort-Frankel update algorithm with per-point coefficients, which reduces
+    // to the above when cl = cr = r
     #pragma omp parallel for
     for (int i = 1; i < n-1; i++)
-        uk[i] = q * (1-r) * uk2[i] + q * r * (uk1[i+1] + uk1[i-1]);
+    {
+        Number const r = (cl[i] + cr[i]) / 2;
+        uk[i] = ((1-r) * uk2[i] + cr[i] * uk1[i+1] + cl[i] * uk1[i-1]) / (1+r);
+    }
 
     // enforce boundary conditions
     uk[0  ] = bc0;
@@ -1,5 +1,10 @@
 #include "heat.h"
 
+extern Number *xgrid;
+
+extern Number
+thermal_resistance(Number x);
+
 void 
 compute_exact_steady_state_solution(int n, Number *a, Number dx, char const *ic,
     Number alpha, Number t, Number bc0, Number bc1)
@@ -9,5 +14,5 @@ compute_exact_steady_state_solution(int n, Number *a, Number dx, char const *ic,
     
     #pragma omp parallel for
     for (i = 0; i < n; i++)
-        a[i] = bc0 + (bc1-bc0)*i*dx/(double)n;
+        a[i] = bc0 + (bc1-bc0)*thermal_resistance(xgrid[i])/thermal_resistance(xgrid[n-1]);
 }
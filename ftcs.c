@@ -1,5 +1,14 @@
 #include "heat.h"
 
+extern int
+laplacian_stencil(int order, Number const **c);
+
+extern Number
+laplacian_at(int n, Number const *u, int i, int h, Number const *c);
+
+extern void
+copy(int n, Number *dst, Number const *src);
+
 int                        // false if unstable, true otherwise
 update_solution_ftcs(
     int n,                  // number of samples
@@ -7,17 +16,205 @@ update_solution_ftcs(
     Number const *uk1,      // array u(x,k-1) computed @ -1 time index ago
     Number alpha,           // thermal diffusivity
     Number dx, Number dt,   // spacing in space, x, and time, t.
-    Number bc0, Number bc1) // boundary conditions @ x=0 & x=Lx
+    Number bc0, Number bc1, // boundary conditions @ x=0 & x=Lx
+    int order)              // spatial order of accuracy, 2, 4 or 6
 {
     Number r = alpha * dt / (dx * dx);
+    Number const *c;
+    int const h = laplacian_stencil(order, &c);
+
+    if (order == 2)
+    {
+        // sanity check for stability
+        if (r > 0.5) return 0; 
+
+        // FTCS update algorithm
+        #pragma omp parallel for
+        for (int i = 1; i < n-1; i++)
+            uk[i] = r*uk1[i+1] + (1-2*r)*uk1[i] + r*uk1[i-1];
+    }
+    else
+    {
+        // sanity check for stability, the stencil's symbol is largest at
+        // the highest frequency and the update must not amplify it
+        Number symbol = c[0];
+        for (int k = 1; k <= h; k++)
+            symbol += 2 * (k%2 ? -c[k] : c[k]);
+        if (r * fabs(symbol) > 2) return 0;
+
+        // FTCS update algorithm with a wide stencil
+        #pragma omp parallel for
+        for (int i = h; i < n-h; i++)
+        {
+            Number lap = c[0] * uk1[i];
+            for (int k = 1; k <= h; k++)
+                lap += c[k] * (uk1[i-k] + uk1[i+k]);
+            uk[i] = uk1[i] + r * lap;
+        }
 
-    // sanity check for stability
-    if (r > 0.5) return 0; 
+        // points whose stencil reaches beyond the boundaries
+        for (int i = 1; i < h; i++)
+        {
+            uk[i    ] = uk1[i    ] + r * laplacian_at(n, uk1, i,     h, c);
+            uk[n-1-i] = uk1[n-1-i] + r * laplacian_at(n, uk1, n-1-i, h, c);
+        }
+    }
+
+    // enforce boundary conditions
+    uk[0  ] = bc0;
+    uk[n-1] = bc1;
+
+    return 1;
+}
 
-    // FTCS update algorithm
+int                        // false if unstable, true otherwise
+update_solution_ftcs_flux(
+    int n,                  // number of samples
+    Number *uk,             // new array of u(x,k) to compute/return
+    Number const *uk1,      // array u(x,k-1) computed @ -1 time index ago
+    Number const *cl,       // coefficients of differences to left neighbors
+    Number const *cr,       // coefficients of differences to right neighbors
+    Number rmax,            // largest local r, (cl+cr)/2
+    Number bc0, Number bc1) // boundary conditions @ x=0 & x=Lx
+{
+    int i;
+
+    // sanity check for stability using the largest local r
+    if (rmax > 0.5) return 0;
+
+    // FTCS update algorithm with per-point coefficients
     #pragma omp parallel for
-    for (int i = 1; i < n-1; i++)
-        uk[i] = r*uk1[i+1] + (1-2*r)*uk1[i] + r*uk1[i-1];
+    for (i = 1; i < n-1; i++)
+        uk[i] = uk1[i] + cr[i]*(uk1[i+1]-uk1[i]) - cl[i]*(uk1[i]-uk1[i-1]);
+
+    // enforce boundary conditions
+    uk[0  ] = bc0;
+    uk[n-1] = bc1;
+
+    return 1;
+}
+
+// Local time stepping: a point at level L takes 2^L substeps of dt/2^L,
+// just enough for its own stability, instead of every point taking the
+// substeps the finest point needs.
+#define LTS_MAXLEVEL 16
+static int        lts_maxlevel = 0;
+static int const *lts_level = 0;          // level of each point
+static int const *lts_faces = 0;          // faces ordered by decreasing level
+static int const *lts_points = 0;         // points ordered by decreasing level
+static int        lts_nfaces[LTS_MAXLEVEL+2];  // number of faces at level >= L
+static int        lts_npoints[LTS_MAXLEVEL+2]; // number of points at level >= L
+
+#define MAX(A,B) ((A)>(B)?(A):(B))
+
+// Assign levels from cl, cr and order points and faces (the face f lies
+// between points f and f+1) by level. Returns the number of levels or 0
+// if some point would need more than LTS_MAXLEVEL.
+int
+initialize_ftcs_lts(int n, Number const *cl, Number const *cr,
+    int *level, int *faces, int *points)
+{
+    int i, L;
+    int nextf[LTS_MAXLEVEL+1], nextp[LTS_MAXLEVEL+1];
+
+    lts_maxlevel = 0;
+    level[0] = level[n-1] = 0;
+    for (i = 1; i < n-1; i++)
+    {
+        Number c = cl[i] + cr[i];
+        for (L = 0; c > 1 && L <= LTS_MAXLEVEL; L++)
+            c /= 2;
+        if (L > LTS_MAXLEVEL)
+            return 0;
+        level[i] = L;
+        lts_maxlevel = MAX(lts_maxlevel, L);
+    }
+
+    // count faces and points at each level, then at each level and above
+    for (L = 0; L <= LTS_MAXLEVEL+1; L++)
+        lts_nfaces[L] = lts_npoints[L] = 0;
+    for (i = 0; i < n-1; i++)
+        lts_nfaces[MAX(level[i], level[i+1])]++;
+    for (i = 1; i < n-1; i++)
+        lts_npoints[level[i]]++;
+    for (L = lts_maxlevel-1; L >= 0; L--)
+    {
+        lts_nfaces[L] += lts_nfaces[L+1];
+        lts_npoints[L] += lts_npoints[L+1];
+    }
+
+    // sort by decreasing level, level L going after all those above it
+    for (L = 0; L <= lts_maxlevel; L++)
+    {
+        nextf[L] = lts_nfaces[L+1];
+        nextp[L] = lts_npoints[L+1];
+    }
+    for (i = 0; i < n-1; i++)
+        faces[nextf[MAX(level[i], level[i+1])]++] = i;
+    for (i = 1; i < n-1; i++)
+        points[nextp[level[i]]++] = i;
+
+    lts_level = level;
+    lts_faces = faces;
+    lts_points = points;
+
+    return lts_maxlevel + 1;
+}
+
+// Number of trailing zero bits of s > 0
+static int
+trailing_zeros(int s)
+{
+    int z = 0;
+    for (; !(s & 1); s >>= 1)
+        z++;
+    return z;
+}
+
+int                        // false if levels are uninitialized, true otherwise
+update_solution_ftcs_lts(
+    int n,                  // number of samples
+    Number *uk,             // new array of u(x,k) to compute/return
+    Number const *uk1,      // array u(x,k-1) computed @ -1 time index ago
+    Number const *cl,       // coefficients of differences to left neighbors
+    Number const *cr,       // coefficients of differences to right neighbors
+    Number *du,             // scratch array for accumulated changes
+    Number bc0, Number bc1) // boundary conditions @ x=0 & x=Lx
+{
+    int const nsub = 1 << lts_maxlevel;
+
+    if (!lts_level) return 0;
+
+    copy(n, uk, uk1);
+    memset(du, 0, n * sizeof(Number));
+
+    // At each substep, s, faces whose level's step starts at s add their
+    // (conserved) flux over that step to the changes of both neighbors.
+    // Then points whose level's step ends after s apply their changes.
+    // A point's value is thus frozen over its own step, which keeps each
+    // update a convex combination of values. These loops are serial since
+    // neighboring faces change the same point.
+    for (int s = 0; s < nsub; s++)
+    {
+        int const lf = s ? lts_maxlevel - trailing_zeros(s) : 0;
+        int const lp = lts_maxlevel - trailing_zeros(s+1);
+
+        for (int k = 0; k < lts_nfaces[lf]; k++)
+        {
+            int const f = lts_faces[k];
+            int const L = MAX(lts_level[f], lts_level[f+1]);
+            Number const d = ldexp(uk[f+1] - uk[f], -L);
+            du[f  ] += cr[f  ] * d;
+            du[f+1] -= cl[f+1] * d;
+        }
+
+        for (int k = 0; k < lts_npoints[lp]; k++)
+        {
+            int const i = lts_points[k];
+            uk[i] += du[i];
+            du[i] = 0;
+        }
+    }
 
     // enforce boundary conditions
     uk[0  ] = bc0;
@@ -0,0 +1,355 @@
+#include "heat.h"
+
+extern void
+copy(int n, Number *dst, Number const *src);
+
+// Fill x with the n sample positions over [0,lenx] specified by grid
+void
+initialize_grid(int n, Number lenx, char const *grid, Number *x)
+{
+    int i;
+    Number const dx = lenx / (n-1);
+
+    if (!strncmp(grid, "cluster(", 8)) /* cluster(Xc,S) */
+    {
+        // Stretching that clusters points about x=Xc with strength S > 0,
+        // Anderson, Tannehill & Pletcher, Computational Fluid Mechanics
+        char *p;
+        double xc = strtod(grid+8, &p);
+        double s = strtod(p+1, &p);
+        double d = xc / lenx;
+        double a;
+
+        if (strcmp(p, ")") || s <= 0 || xc < 0 || xc > lenx)
+        {
+            fprintf(stderr, "Clustering needs S>0 and Xc in [0,%g]\n", (double) lenx);
+            exit(1);
+        }
+
+        if (xc == 0)
+        {
+            // One-sided stretching clusters at the wall, x=0
+            for (i = 0; i < n; i++)
+                x[i] = lenx * sinh(s * (double) i/(n-1)) / sinh(s);
+        }
+        else
+        {
+            a = log((1 + (exp(s)-1)*d) / (1 + (exp(-s)-1)*d)) / (2*s);
+            for (i = 0; i < n; i++)
+                x[i] = xc * (1 + sinh(s * ((double) i/(n-1) - a)) / sinh(s*a));
+        }
+    }
+    else if (!strncmp(grid, "adapt(", 6) || !strcmp(grid, "uniform")) /* adapt(K,B) */
+    {
+        if (grid[0] == 'a')
+        {
+            char *p;
+            long k = strtol(grid+6, &p, 10);
+            double b = *p == ',' ? strtod(p+1, &p) : -1;
+
+            if (strcmp(p, ")") || k < 1 || b < 0)
+            {
+                fprintf(stderr, "Adaptive grids need K>=1 and B>=0\n");
+                exit(1);
+            }
+        }
+
+        // adaptive grids start uniform
+        for (i = 0; i < n; i++)
+            x[i] = i*dx;
+    }
+    else
+    {
+        fprintf(stderr, "Unrecognized grid \"%s\"\n", grid);
+        exit(1);
+    }
+
+    x[0] = 0;
+    x[n-1] = lenx;
+}
+
+// Piecewise constant thermal diffusivity, alpha(x), as layers in x
+static int     nlayers = 0;
+static Number *layer_x0 = 0;     // x at which each layer starts
+static Number *layer_alpha = 0;  // diffusivity of each layer
+static Number *layer_r0 = 0;     // resistance, integral of 1/alpha, from 0 to layer_x0
+
+static void
+add_layer(int *maxlayers, Number x0, Number a)
+{
+    if (a <= 0)
+    {
+        fprintf(stderr, "Diffusivity of layer at x=%g must be positive\n", (double) x0);
+        exit(1);
+    }
+    if (nlayers && x0 <= layer_x0[nlayers-1])
+    {
+        fprintf(stderr, "Layers must be given in order of increasing x\n");
+        exit(1);
+    }
+    if (nlayers == *maxlayers)
+    {
+        *maxlayers = 2 * *maxlayers + 4;
+        layer_x0 = (Number*) realloc(layer_x0, *maxlayers * sizeof(Number));
+        layer_alpha = (Number*) realloc(layer_alpha, *maxlayers * sizeof(Number));
+    }
+    layer_x0[nlayers] = x0;
+    layer_alpha[nlayers] = a;
+    nlayers++;
+}
+
+static void
+malformed_layers(char const *alphax)
+{
+    fprintf(stderr, "Malformed diffusivity \"%s\"\n", alphax);
+    exit(1);
+}
+
+// Set up alpha(x) over [0,lenx] as specified by alphax, which defaults to
+// alpha everywhere
+void
+initialize_layers(Number alpha, Number lenx, char const *alphax)
+{
+    int i, maxlayers = 0;
+
+    if (!strncmp(alphax, "layers(", 7)) /* layers(A0,X1,A1,X2,A2,...) */
+    {
+        char const *p = alphax+6;
+        char *q;
+        Number x0 = 0;
+
+        do
+        {
+            Number const a = strtod(p+1, &q);
+            if (q == p+1)
+                malformed_layers(alphax);
+            add_layer(&maxlayers, x0, a);
+            if (*q != ',')
+                break;
+            p = q;
+            x0 = strtod(p+1, &q);
+            if (q == p+1 || *q != ',')
+                malformed_layers(alphax);
+            p = q;
+        } while (1);
+        if (strcmp(q, ")"))
+            malformed_layers(alphax);
+    }
+    else if (!strncmp(alphax, "file(", 5)) /* file(layers.dat) of x0 alpha pairs */
+    {
+        FILE *layfile;
+        char *filename = strdup(&alphax[5]);
+        char *parenchar  = strchr(filename, ')');
+        double x0, a;
+
+        if (!parenchar || parenchar[1])
+            malformed_layers(alphax);
+        *parenchar = '\0';
+        layfile = fopen(filename, "r");
+        if (!layfile)
+        {
+            fprintf(stderr, "Unable to open layers file \"%s\"\n", filename);
+            exit(1);
+        }
+        while (fscanf(layfile, "%lg %lg", &x0, &a) == 2)
+        {
+            if (!nlayers && x0 != 0)
+            {
+                fprintf(stderr, "First layer in \"%s\" must start at x=0\n", filename);
+                exit(1);
+            }
+            add_layer(&maxlayers, x0, a);
+        }
+        if (!feof(layfile))
+        {
+            fprintf(stderr, "Layers file \"%s\" must hold only x alpha pairs\n", filename);
+            exit(1);
+        }
+        fclose(layfile);
+        free(filename);
+    }
+    else if (strcmp(alphax, "uniform"))
+    {
+        fprintf(stderr, "Unrecognized diffusivity \"%s\"\n", alphax);
+        exit(1);
+    }
+
+    for (i = 1; i < nlayers; i++)
+    {
+        if (layer_x0[i] >= lenx)
+        {
+            fprintf(stderr, "Layer at x=%g starts beyond lenx=%g\n", (double) layer_x0[i], (double) lenx);
+            exit(1);
+        }
+    }
+
+    if (!nlayers)
+        add_layer(&maxlayers, 0, alpha);
+
+    layer_r0 = (Number*) malloc(nlayers * sizeof(Number));
+    layer_r0[0] = 0;
+    for (i = 1; i < nlayers; i++)
+        layer_r0[i] = layer_r0[i-1] + (layer_x0[i] - layer_x0[i-1]) / layer_alpha[i-1];
+}
+
+void
+finalize_layers(void)
+{
+    free(layer_x0);
+    free(layer_alpha);
+    free(layer_r0);
+    layer_x0 = layer_alpha = layer_r0 = 0;
+    nlayers = 0;
+}
+
+// Index of the layer containing x
+static int
+find_layer(Number x)
+{
+    int lo = 0, hi = nlayers-1;
+
+    while (lo < hi)
+    {
+        int const mid = (lo + hi + 1) / 2;
+        if (layer_x0[mid] <= x) lo = mid;
+        else                    hi = mid-1;
+    }
+    return lo;
+}
+
+// Resistance, the integral of 1/alpha, from 0 to x
+Number
+thermal_resistance(Number x)
+{
+    int const j = find_layer(x);
+    return layer_r0[j] + (x - layer_x0[j]) / layer_alpha[j];
+}
+
+// Resistance from x0 to x1 summed over the layers between them
+static Number
+interval_resistance(Number x0, Number x1)
+{
+    int j = find_layer(x0);
+    Number r = 0;
+
+    for (; j+1 < nlayers && layer_x0[j+1] < x1; j++)
+    {
+        r += (layer_x0[j+1] - x0) / layer_alpha[j];
+        x0 = layer_x0[j+1];
+    }
+    return r + (x1 - x0) / layer_alpha[j];
+}
+
+// Coefficients of the differences to the left and right neighbors of each
+// point for a finite volume discretization about the point with faces
+// midway to its neighbors. The diffusivity between neighbors is that of
+// the layers between them in series, h/integral(1/alpha), so jumps in
+// alpha need not fall on points. For uniform x and alpha both are
+// alpha*dt/dx^2. Returns the largest local r, (cl+cr)/2.
+Number
+compute_grid_coefs(int n, Number const *x, Number dt,
+    Number *cl, Number *cr)
+{
+    int i;
+    Number rmax = 0;
+
+    cl[0] = cr[0] = cl[n-1] = cr[n-1] = 0;
+
+    #pragma omp parallel for reduction(max:rmax)
+    for (i = 1; i < n-1; i++)
+    {
+        Number const vol = (x[i+1] - x[i-1]) / 2;
+        cl[i] = dt / (interval_resistance(x[i-1], x[i]) * vol);
+        cr[i] = dt / (interval_resistance(x[i], x[i+1]) * vol);
+        rmax = (cl[i] + cr[i]) / 2 > rmax ? (cl[i] + cr[i]) / 2 : rmax;
+    }
+
+    return rmax;
+}
+
+// Linearly interpolate u from the points xold onto the points xnew
+static void
+interpolate(int n, Number const *xold, Number const *u,
+    Number const *xnew, Number *unew)
+{
+    int i, j;
+
+    unew[0] = u[0];
+    unew[n-1] = u[n-1];
+    for (i = 1, j = 0; i < n-1; i++)
+    {
+        while (j < n-2 && xold[j+1] < xnew[i])
+            j++;
+        unew[i] = u[j] + (u[j+1] - u[j]) * (xnew[i] - xold[j]) / (xold[j+1] - xold[j]);
+    }
+}
+
+// Move the points, x, to equidistribute the monitor w = 1 + B*|du/dx|/max|du/dx|,
+// so the spacing where the solution is steepest is up to 1+B times finer than
+// where it is flat, and interpolate u and, if given, u2 onto the new points.
+// As the solution diffuses, its gradient evens out and so does the spacing.
+// work must hold 2n values.
+void
+adapt_grid(int n, Number *x, Number *u, Number *u2, char const *grid,
+    Number *work)
+{
+    int i, j;
+    char *p;
+    Number *xnew = work;
+    Number *w = work + n;
+    Number gmax = 0, m, mtot;
+
+    strtol(grid+6, &p, 10);
+    double beta = strtod(p+1, 0);
+
+    // gradient on each interval
+    for (j = 0; j < n-1; j++)
+    {
+        w[j] = fabs(u[j+1] - u[j]) / (x[j+1] - x[j]);
+        if (w[j] > gmax) gmax = w[j];
+    }
+    if (gmax == 0)
+        return;
+
+    // monitor on each interval, smoothed so that spacing varies gradually
+    for (j = 0; j < n-1; j++)
+        w[j] = 1 + beta * w[j] / gmax;
+    for (i = 0; i < 4; i++)
+    {
+        Number prev = w[0];
+        for (j = 1; j < n-2; j++)
+        {
+            Number const cur = w[j];
+            w[j] = (prev + 2*cur + w[j+1]) / 4;
+            prev = cur;
+        }
+    }
+
+    // total of the monitor over [0,lenx]
+    for (j = 0, mtot = 0; j < n-1; j++)
+        mtot += w[j] * (x[j+1] - x[j]);
+
+    // place point i where the running total of the monitor reaches i/(n-1) of it
+    xnew[0] = x[0];
+    xnew[n-1] = x[n-1];
+    for (i = 1, j = 0, m = 0; i < n-1; i++)
+    {
+        Number const target = mtot * i / (n-1);
+        while (j < n-2 && m + w[j] * (x[j+1] - x[j]) < target)
+        {
+            m += w[j] * (x[j+1] - x[j]);
+            j++;
+        }
+        xnew[i] = x[j] + (target - m) / w[j];
+    }
+
+    // the monitor is no longer needed so interpolate into its storage
+    interpolate(n, x, u, xnew, w);
+    copy(n, u, w);
+    if (u2)
+    {
+        interpolate(n, x, u2, xnew, w);
+        copy(n, u2, w);
+    }
+    copy(n, x, xnew);
+}
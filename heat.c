@@ -4,13 +4,22 @@
 
 // Command-line argument variables
 int noout        = 0;
+int binout       = 0;
 int savi         = 0;
 int outi         = 100;
 int save         = 0;
 int nt           = 0; // number of parallel tasks
+int hugepg       = 0;
+int order        = 2; // spatial order of accuracy
+int lts          = 0; // local time stepping
+int chki         = 1; // check for convergence every i-th step
+int insiti       = 1; // write in-situ analysis every i-th step
 char const *runame = "heat_results";
 char const *alg  = "ftcs";
 char const *ic   = "const(1)";
+char const *grid = "uniform";
+char const *alphax = "uniform";
+char const *insitu = "none";
 Number lenx      = 1.0;
 Number alpha     = 0.2;
 Number dt        = 0.004;
@@ -19,6 +28,7 @@ Number bc0       = 0.0;
 Number bc1       = 1.0;
 Number maxt      = 2.0;
 Number min_change = 1e-8*1e-8;
+Number compress  = 0; // absolute error bound of compressed solutions
 
 // Various arrays of numerical data
 Number *curr           = 0; // current solution
@@ -28,15 +38,29 @@ Number *exact          = 0; // exact solution (when available)
 Number *change_history = 0; // solution l2norm change history
 Number *error_history  = 0; // solution error history (when available)
 Number *cn_Amat        = 0; // A matrix for Crank-Nicholson
+Number *xgrid          = 0; // x coordinates of the samples
+Number *coefl          = 0; // coefficients of differences to left neighbors
+Number *coefr          = 0; // coefficients of differences to right neighbors
+Number *grid_work      = 0; // scratch for adapting the grid and local time stepping
+int    *lts_work       = 0; // levels, faces and points for local time stepping
 
 // Number of points in space, x, and time, t.
 int Nx;
 int Nt;
 
+// Adapt the grid every i-th step (0=never)
+static int adapti = 0;
+
+// Largest local r = alpha*dt/dx^2 over all points
+static Number rmax = 0;
+
 // Utilities
 extern Number
 l2_norm(int n, Number const *a, Number const *b);
 
+extern Number
+l2_norm_sampled(int n, Number const *a, Number const *b, int stride);
+
 extern void
 copy(int n, Number *dst, Number const *src);
 
@@ -49,8 +73,45 @@ set_initial_condition(int n, Number *a, Number dx, char const *ic);
 extern void
 initialize_crankn(int n,
     Number alpha, Number dx, Number dt,
+    int order, Number const *cl, Number const *cr,
     Number **_cn_Amat);
 
+extern void
+build_crankn(int n,
+    Number alpha, Number dx, Number dt,
+    int order, Number const *cl, Number const *cr,
+    Number *cn_Amat);
+
+extern void
+initialize_grid(int n, Number lenx, char const *grid, Number *x);
+
+extern void
+initialize_layers(Number alpha, Number lenx, char const *alphax);
+
+extern void
+finalize_layers(void);
+
+extern Number
+compute_grid_coefs(int n, Number const *x, Number dt,
+    Number *cl, Number *cr);
+
+extern void
+adapt_grid(int n, Number *x, Number *u, Number *u2, char const *grid,
+    Number *work);
+
+extern void
+initialize_analysis(char const *insitu, int n, Number const *x, Number const *u);
+
+extern void
+update_analysis(int ti, Number t, int n, Number const *x, Number const *u);
+
+extern void
+finalize_analysis(void);
+
+extern int
+initialize_ftcs_lts(int n, Number const *cl, Number const *cr,
+    int *level, int *faces, int *points);
+
 extern void
 process_args(int argc, char **argv);
 
@@ -62,19 +123,49 @@ extern int
 update_solution_ftcs(int n,
     Number *curr, Number const *back1,
     Number alpha, Number dx, Number dt,
+    Number bc_0, Number bc_1, int order);
+
+extern int
+update_solution_ftcs_flux(int n,
+    Number *curr, Number const *back1,
+    Number const *cl, Number const *cr, Number rmax,
+    Number bc_0, Number bc_1);
+
+extern int
+update_solution_ftcs_lts(int n,
+    Number *curr, Number const *back1,
+    Number const *cl, Number const *cr, Number *du,
+    Number bc_0, Number bc_1);
+
+extern int
+update_solution_dufrank_flux(int n, Number *curr,
+    Number const *back1, Number const *back2,
+    Number const *cl, Number const *cr,
     Number bc_0, Number bc_1);
 
 extern int
 update_solution_crankn(int n,
     Number *curr, Number const *back1,
     Number const *cn_Amat,
-    Number bc_0, Number bc_1);
+    Number bc_0, Number bc_1, int order);
 
 extern int
 update_solution_dufrank(int n, Number *curr,
     Number const *back1, Number const *back2,
     Number alpha, Number dx, Number dt,
-    Number bc_0, Number bc_1);
+    Number bc_0, Number bc_1, int order);
+
+extern size_t
+arena_bytes(size_t nbytes);
+
+extern void
+arena_create(size_t nbytes, int hugepg);
+
+extern void *
+arena_alloc(size_t nbytes);
+
+extern void
+arena_destroy(void);
 
 extern double getWallTimeUsec();
 void updateAvg(double);
@@ -87,19 +178,53 @@ initialize(void)
     Nt = (int) (maxt/dt);
     dx = lenx/(Nx-1);
 
-    curr  = (Number*) malloc(Nx * sizeof(Number));
-    back1 = (Number*) malloc(Nx * sizeof(Number));
-    if (save)
-    {
-        exact = (Number*) malloc(Nx * sizeof(Number));
-        change_history = (Number*) malloc(Nx * sizeof(Number));
-        error_history = (Number*) malloc(Nx * sizeof(Number));
-    }
-
     assert(strncmp(alg, "ftcs", 4)==0 ||
            strncmp(alg, "dufrank", 7)==0 ||
            strncmp(alg, "crankn", 6)==0);
 
+    if (Nx <= order)
+    {
+        fprintf(stderr, "Need more than %d points for order=%d\n", order, order);
+        exit(1);
+    }
+
+    // Anything but a uniform grid and alpha uses per-point coefficients
+    int const nonuniform = strncmp(grid, "uniform", 7) || strncmp(alphax, "uniform", 7) || lts;
+    if (!strncmp(grid, "adapt(", 6))
+        adapti = (int) strtol(grid+6, 0, 10);
+
+    // Size all solver arrays up front and carve them from one arena
+    size_t const vsize = arena_bytes(Nx * sizeof(Number));
+    size_t nbytes = 3 * vsize;
+    if (save)
+        nbytes += 3 * vsize;
+    if (!strncmp(alg, "dufrank", 7))
+        nbytes += vsize;
+    if (!strncmp(alg, "crankn", 6))
+        nbytes += arena_bytes((order+1) * Nx * sizeof(Number));
+    if (nonuniform)
+        nbytes += 4 * vsize + arena_bytes(3 * Nx * sizeof(int));
+    arena_create(nbytes, hugepg);
+
+    curr  = (Number*) arena_alloc(Nx * sizeof(Number));
+    back1 = (Number*) arena_alloc(Nx * sizeof(Number));
+    xgrid = (Number*) arena_alloc(Nx * sizeof(Number));
+    if (save)
+    {
+        exact = (Number*) arena_alloc(Nx * sizeof(Number));
+        change_history = (Number*) arena_alloc(Nx * sizeof(Number));
+        error_history = (Number*) arena_alloc(Nx * sizeof(Number));
+    }
+    if (nonuniform)
+    {
+        coefl = (Number*) arena_alloc(Nx * sizeof(Number));
+        coefr = (Number*) arena_alloc(Nx * sizeof(Number));
+        grid_work = (Number*) arena_alloc(2 * Nx * sizeof(Number));
+        lts_work = (int*) arena_alloc(3 * Nx * sizeof(int));
+    }
+    if (!strncmp(alg, "dufrank", 7))
+        back2 = (Number*) arena_alloc(Nx * sizeof(Number));
+
 #ifdef HAVE_FEENABLEEXCEPT
     feenableexcept(FE_INVALID | FE_DIVBYZERO | FE_OVERFLOW | FE_UNDERFLOW);
 #endif
@@ -111,21 +236,57 @@ initialize(void)
         omp_set_num_threads(1);
 #endif
 
+    /* Set initial condition 2 timesteps back (back2) for dufrank and
+       1 timestep back (back1) otherwise, adapting the grid to it */
+    initialize_grid(Nx, lenx, grid, xgrid);
+    initialize_layers(alpha, lenx, alphax);
+    set_initial_condition(Nx, back2 ? back2 : back1, dx, ic);
+    if (adapti)
+    {
+        adapt_grid(Nx, xgrid, back2 ? back2 : back1, 0, grid, grid_work);
+        write_array(TSTART, Nx, dx, back2 ? back2 : back1);
+    }
+
+    if (nonuniform)
+    {
+        rmax = compute_grid_coefs(Nx, xgrid, dt, coefl, coefr);
+        if (!initialize_ftcs_lts(Nx, coefl, coefr, lts_work, lts_work+Nx, lts_work+2*Nx) &&
+            (lts || back2))
+        {
+            fprintf(stderr, "Time step too large for local time stepping\n");
+            exit(1);
+        }
+    }
+
+    initialize_analysis(insitu, Nx, xgrid, back2 ? back2 : back1);
+
     if (!strncmp(alg, "crankn", 6))
-        initialize_crankn(Nx, alpha, dx, dt, &cn_Amat);
+        initialize_crankn(Nx, alpha, dx, dt, order, coefl, coefr, &cn_Amat);
 
-    if (!strncmp(alg, "dufrank", 7))
+    /* Use FTCS once to set the initial condition for 1 timestep back (back1) */
+    if (back2 && nonuniform)
+        update_solution_ftcs_lts(Nx, back1, back2, coefl, coefr, grid_work, bc0, bc1);
+    else if (back2 && !update_solution_ftcs(Nx, back1, back2, alpha, dx, dt, bc0, bc1, order))
     {
-        back2 = (Number*) malloc(Nx * sizeof(Number));
-        /* Set initial condition 2 timesteps back (back2) and use
-           FTCS once to set the initial condition for 1 timestep back (back1) */
-        set_initial_condition(Nx, back2, dx, ic);
-        update_solution_ftcs(Nx, back1, back2, alpha, dx, dt, bc0, bc1);
+        fprintf(stderr, "Solution criteria violated. Make better choices\n");
+        exit(1);
     }
-    else
+}
+
+// Move the grid points to follow the solution and update all that depends on them
+static void
+regrid(void)
+{
+    adapt_grid(Nx, xgrid, back1, back2, grid, grid_work);
+    copy(Nx, curr, back1);
+    rmax = compute_grid_coefs(Nx, xgrid, dt, coefl, coefr);
+    if (!initialize_ftcs_lts(Nx, coefl, coefr, lts_work, lts_work+Nx, lts_work+2*Nx) && lts)
     {
-        set_initial_condition(Nx, back1, dx, ic);
+        fprintf(stderr, "Time step too large for local time stepping\n");
+        exit(1);
     }
+    if (cn_Amat)
+        build_crankn(Nx, alpha, dx, dt, order, coefl, coefr, cn_Amat);
 }
 
 int finalize(int ti, Number maxt, Number change)
@@ -144,15 +305,14 @@ int finalize(int ti, Number maxt, Number change)
         printf("Iteration %04d: last change l2=%g\n", ti, (double) change);
     }
 
-    free(curr);
-    free(back1);
-    if (back2) free(back2);
-    if (exact) free(exact);
-    if (change_history) free(change_history);
-    if (error_history) free(error_history);
-    if (cn_Amat) free(cn_Amat);
+    finalize_analysis();
+    arena_destroy();
+    finalize_layers();
     if (strncmp(alg, "ftcs", 4)) free((void*)alg);
     if (strncmp(ic, "const(1)", 8)) free((void*)ic);
+    if (strncmp(grid, "uniform", 7)) free((void*)grid);
+    if (strncmp(alphax, "uniform", 7)) free((void*)alphax);
+    if (strncmp(insitu, "none", 4)) free((void*)insitu);
 
     return retval;
 }
@@ -160,19 +320,25 @@ int finalize(int ti, Number maxt, Number change)
 static int
 update_solution()
 {
-    if (!strcmp(alg, "ftcs"))
-        return update_solution_ftcs(Nx, curr, back1, alpha, dx, dt, bc0, bc1);
+    if (!strcmp(alg, "ftcs") && coefl && lts)
+        return update_solution_ftcs_lts(Nx, curr, back1, coefl, coefr, grid_work, bc0, bc1);
+    else if (!strcmp(alg, "ftcs") && coefl)
+        return update_solution_ftcs_flux(Nx, curr, back1, coefl, coefr, rmax, bc0, bc1);
+    else if (!strcmp(alg, "ftcs"))
+        return update_solution_ftcs(Nx, curr, back1, alpha, dx, dt, bc0, bc1, order);
     else if (!strcmp(alg, "crankn"))
-        return update_solution_crankn(Nx, curr, back1, cn_Amat, bc0, bc1);
+        return update_solution_crankn(Nx, curr, back1, cn_Amat, bc0, bc1, order);
+    else if (!strcmp(alg, "dufrank") && coefl)
+        return update_solution_dufrank_flux(Nx, curr, back1, back2, coefl, coefr, bc0, bc1);
     else if (!strcmp(alg, "dufrank"))
-        return update_solution_dufrank(Nx, curr, back1, back2, alpha, dx, dt, bc0, bc1);
+        return update_solution_dufrank(Nx, curr, back1, back2, alpha, dx, dt, bc0, bc1, order);
     return 0;
 }
 
 static Number
-update_output_files(int ti)
+update_output_files(int ti, int need_change)
 {
-    Number change;
+    Number change = -1;
 
     if (ti>0 && save)
     {
@@ -184,7 +350,8 @@ update_output_files(int ti)
     if (ti>0 && savi && ti%savi==0)
         write_array(ti, Nx, dx, curr);
 
-    change = l2_norm(Nx, curr, back1);
+    if (need_change || save)
+        change = l2_norm(Nx, curr, back1);
     if (save)
     {
         change_history[ti] = change;
@@ -194,11 +361,53 @@ update_output_files(int ti)
     return change;
 }
 
+// Decide if the change in solution is below threshold. With chki=1 this
+// is just the change computed every step. Otherwise, checks happen every
+// chki steps and first use a sampled estimate of the change, paying for
+// the full reduction only when the estimate is within 4x of threshold.
+// Successive estimates give the geometric rate at which the change decays
+// and so the step at which it will reach threshold. The next check is
+// deferred to then. The heat equation's decay only ever slows, as the
+// slowest mode comes to dominate, so the prediction errs early.
+static int
+converged(int ti, Number *change, int *next_check)
+{
+    static int last_ti = -1;
+    static Number last_est = 0;
+    int const stride = Nx/1024 > 1 ? Nx/1024 : 1;
+    Number est;
+
+    *next_check = ti + (chki > 1 ? chki : 1);
+    if (chki <= 1)
+        return *change < min_change;
+
+    est = l2_norm_sampled(Nx, curr, back1, stride);
+    if (est < 4 * min_change)
+    {
+        *change = l2_norm(Nx, curr, back1);
+        if (*change < min_change)
+            return 1;
+    }
+
+    if (last_ti >= 0 && 0 < est && est < last_est)
+    {
+        double const rate = log(est / last_est) / (ti - last_ti);
+        double const steps = log(min_change / est) / rate;
+        if (steps > chki && steps < INT_MAX - ti)
+            *next_check = ti + (int) steps;
+    }
+    last_ti = ti;
+    last_est = est;
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int ti;
+    int next_check = 0;
     double t1, t2, tdiff;
-    Number change;
+    Number change = 0;
 
     // Read command-line args and set values
     process_args(argc, argv);
@@ -210,6 +419,11 @@ int main(int argc, char **argv)
     t1 = getWallTimeUsec();
     for (ti = 0; ti*dt < maxt; ti++)
     {
+        int const check = maxt == INT_MAX && ti >= next_check;
+        int const output = outi && ti%outi==0;
+        int const last = (ti+1)*dt >= maxt;
+        Number new_change;
+
         // compute the next solution step
         if (!update_solution())
         {
@@ -217,11 +431,16 @@ int main(int argc, char **argv)
             exit(1);
         }
 
-        // compute amount of change in solution
-        change = update_output_files(ti);
+        // compute amount of change in solution only when it will be used
+        new_change = update_output_files(ti, output || last || (check && chki <= 1));
+        if (new_change >= 0)
+            change = new_change;
+
+        // Reduce the new solution to the in-situ analysis time series
+        update_analysis(ti+1, (ti+1)*dt, Nx, xgrid, curr);
 
         // Handle possible termination by change threshold
-        if (maxt == INT_MAX && change < min_change)
+        if (check && converged(ti, &change, &next_check))
         {
             printf("Stopped after %06d iterations for threshold %g\n",
                 ti, (double) change);
@@ -229,7 +448,7 @@ int main(int argc, char **argv)
         }
 
         // Output progress
-        if (outi && ti%outi==0)
+        if (output)
             printf("Iteration %04d: last change l2=%g\n", ti, (double) change);
 
         // Copy current solution to backi
@@ -237,6 +456,10 @@ int main(int argc, char **argv)
             copy(Nx, back2, back1);
         copy(Nx, back1, curr);
 
+        // Adapt the grid to the new solution
+        if (adapti && (ti+1)%adapti==0)
+            regrid();
+
     }
     t2 = getWallTimeUsec();
     printf("Elapsed time = %8.16g msec\n\n", (t2 - t1) / 1000.0);
@@ -0,0 +1,53 @@
+#include "heat.h"
+
+extern int
+read_compressed(char const *fname, Number **x, Number **a);
+
+// Decompress solution files written with compress=E into .curve files
+// beside them, for the plotting tools, e.g. ./heatz2curve heat_results/*.heatz
+int main(int argc, char **argv)
+{
+    int f;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <file.heatz> <file.heatz>...\n", argv[0]);
+        exit(1);
+    }
+
+    for (f = 1; f < argc; f++)
+    {
+        Number *x, *a;
+        char fname[1024];
+        char *ext;
+        FILE *outf;
+        int i, n;
+
+        snprintf(fname, sizeof(fname), "%s", argv[f]);
+        ext = strrchr(fname, '.');
+        if (!ext || strcmp(ext, ".heatz"))
+        {
+            fprintf(stderr, "File \"%s\" does not end in .heatz\n", argv[f]);
+            exit(1);
+        }
+        strcpy(ext, ".curve");
+
+        n = read_compressed(argv[f], &x, &a);
+
+        outf = fopen(fname, "w");
+        if (!outf)
+        {
+            fprintf(stderr, "Unable to open \"%s\" for writing\n", fname);
+            exit(1);
+        }
+        fprintf(outf, "# Temperature\n");
+        for (i = 0; i < n; i++)
+            fprintf(outf, FPFMT " " FPFMT "\n", (FPCAST) x[i], (FPCAST) a[i]);
+        fclose(outf);
+
+        free(x);
+        free(a);
+    }
+
+    return 0;
+}
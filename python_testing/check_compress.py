@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+import sys, glob, os
+
+def main():
+    """
+    Confirm solutions of a run with compress=<errbnd>, decompressed with
+    heatz2curve, are within errbnd of the same run's text solutions and
+    report how much smaller the compressed files are.
+
+    Usage: check_compress.py <errbnd> <text-runame> <compressed-runame>
+    """
+    if len(sys.argv) < 4:
+        print("Specify error bound, text run name and compressed run name as arguments")
+        sys.exit(1)
+
+    errbnd = float(sys.argv[1])
+    trun = sys.argv[2]
+    zrun = sys.argv[3]
+
+    def read_curve(rdfile):
+        vals = []
+        with open(rdfile, 'r') as file:
+            for line in file:
+                if '#' in line:
+                    continue
+                parts = line.split()
+                if len(parts) < 2:
+                    continue
+                vals.append((float(parts[0]), float(parts[1])))
+        return vals
+
+    tfiles = sorted(glob.glob(f"{trun}/{trun}_soln_*.curve"))
+    if not tfiles:
+        print(f"No solutions found in {trun}")
+        sys.exit(1)
+
+    tbytes = 0
+    zbytes = 0
+    for tfile in tfiles:
+        suffix = tfile[len(f"{trun}/{trun}_"):]
+        zfile = f"{zrun}/{zrun}_{suffix}"
+        try:
+            tvals = read_curve(tfile)
+            zvals = read_curve(zfile)
+        except FileNotFoundError as e:
+            print(f"File not found: {e.filename}")
+            sys.exit(1)
+
+        if len(tvals) != len(zvals):
+            print(f"Check failed, {zfile} has {len(zvals)} values but {tfile} has {len(tvals)}")
+            sys.exit(1)
+
+        for (tx, ty), (zx, zy) in zip(tvals, zvals):
+            diffr = abs(ty - zy)
+            if abs(tx - zx) > 1e-12 or diffr > errbnd:
+                print(f"Check failed in {zfile} at x={zx} y={zy} yexp={ty}, diff={diffr}")
+                sys.exit(1)
+
+        tbytes += os.path.getsize(tfile)
+        zbytes += os.path.getsize(zfile.replace(".curve", ".heatz"))
+
+    print(f"Compressed {len(tfiles)} solutions {tbytes / zbytes:.1f}x, {tbytes} to {zbytes} bytes")
+    sys.exit(0)
+
+if __name__ == "__main__":
+    main()
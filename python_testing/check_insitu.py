@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+import sys, math
+
+def main():
+    """
+    Confirm the in-situ analysis of a run with ic="sin(1,1)" and bc0=bc1=0,
+    whose exact solution is u(x,t) = sin(pi*x)*exp(-alpha*pi^2*t), against
+    insitu="probe(0.5,0.25);stats;cross(0.5,0.5,0.25,0.5)".
+
+    Usage: check_insitu.py <runame> <errbnd> <alpha>
+    """
+    if len(sys.argv) < 4:
+        print("Specify run name, error bound and alpha as arguments")
+        sys.exit(1)
+
+    runame = sys.argv[1]
+    errbnd = float(sys.argv[2])
+    alpha = float(sys.argv[3])
+
+    def decay(t):
+        return math.exp(-alpha * math.pi**2 * t)
+
+    exact = {
+        "probe_0.5":  lambda t: decay(t),
+        "probe_0.25": lambda t: math.sin(math.pi/4) * decay(t),
+        "min":        lambda t: 0.0,
+        "max":        lambda t: decay(t),
+        "mean":       lambda t: 2 / math.pi * decay(t),
+        "cross":      lambda x: math.log(2 * math.sin(math.pi * x)) / (alpha * math.pi**2)
+    }
+
+    for name, f in exact.items():
+        rdfile = f"{runame}/{runame}_{name}.curve"
+        try:
+            with open(rdfile, 'r') as file:
+                for line in file:
+                    if '#' in line:
+                        continue
+
+                    parts = line.split()
+                    if len(parts) < 2:
+                        continue
+
+                    xval = float(parts[0])
+                    yval = float(parts[1])
+                    exact_yval = f(xval)
+                    diffr = abs(yval - exact_yval)
+
+                    if diffr > errbnd:
+                        print(f"Check of {name} failed at {xval} y={yval} yexp={exact_yval}, diff={diffr}")
+                        sys.exit(1)
+        except FileNotFoundError:
+            print(f"File not found: {rdfile}")
+            sys.exit(1)
+    sys.exit(0)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+import sys
+
+def main():
+    """
+    Confirm a steady-state solution through layers of different diffusivity.
+    Heat flux is the same through every layer, so the temperature is
+    piecewise linear with a slope in each layer inversely proportional to
+    its diffusivity.
+
+    Usage: check_layers.py <file> <errbnd> <A0,X1,A1,X2,A2,...> [<Len> <bc0> <bc1>]
+    """
+    if len(sys.argv) < 4:
+        print("Specify input file, error bound and layers as arguments")
+        sys.exit(1)
+
+    rdfile = sys.argv[1]
+    errbnd = float(sys.argv[2])
+    vals = [float(v) for v in sys.argv[3].split(',')]
+    layers = [(0.0, vals[0])] + [(vals[i], vals[i+1]) for i in range(1, len(vals), 2)]
+
+    Len = 1
+    bc0 = 0
+    bc1 = 1
+    if len(sys.argv) > 6:
+        Len = float(sys.argv[4])
+        bc0 = float(sys.argv[5])
+        bc1 = float(sys.argv[6])
+
+    def resistance(x):
+        r = 0
+        for k, (x0, a) in enumerate(layers):
+            x1 = layers[k+1][0] if k+1 < len(layers) else x
+            if x <= x0:
+                break
+            r += (min(x, x1) - x0) / a
+        return r
+
+    try:
+        with open(rdfile, 'r') as file:
+            for line in file:
+                if '#' in line:
+                    continue
+
+                parts = line.split()
+                if len(parts) < 2:
+                    continue
+
+                xval = float(parts[0])
+                yval = float(parts[1])
+                exact_yval = bc0 + (bc1 - bc0) * resistance(xval) / resistance(Len)
+                diffr = abs(yval - exact_yval)
+
+                if diffr > errbnd:
+                    print(f"Check failed at x={xval} y={yval} yexp={exact_yval}, diff={diffr}")
+                    sys.exit(1)
+        sys.exit(0)
+    except FileNotFoundError:
+        print(f"File not found: {rdfile}")
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+import sys
+
+def main():
+    """
+    Confirm a solution is within errbnd of a reference solution at the
+    same points.
+
+    Usage: compare_curves.py <file> <reffile> <errbnd>
+    """
+    if len(sys.argv) < 4:
+        print("Specify input file, reference file and error bound as arguments")
+        sys.exit(1)
+
+    rdfile = sys.argv[1]
+    reffile = sys.argv[2]
+    errbnd = float(sys.argv[3])
+
+    def read_curve(rdfile):
+        vals = []
+        with open(rdfile, 'r') as file:
+            for line in file:
+                if '#' in line:
+                    continue
+                parts = line.split()
+                if len(parts) < 2:
+                    continue
+                vals.append((float(parts[0]), float(parts[1])))
+        return vals
+
+    try:
+        vals = read_curve(rdfile)
+        refs = read_curve(reffile)
+    except FileNotFoundError as e:
+        print(f"File not found: {e.filename}")
+        sys.exit(1)
+
+    if len(vals) != len(refs):
+        print(f"{rdfile} has {len(vals)} values but {reffile} has {len(refs)}")
+        sys.exit(1)
+
+    maxdiff = 0
+    for (xval, yval), (xref, yref) in zip(vals, refs):
+        diffr = abs(yval - yref)
+        if abs(xval - xref) > 1e-12:
+            print(f"Check failed, x={xval} but reference x={xref}")
+            sys.exit(1)
+        if diffr > errbnd:
+            print(f"Check failed at x={xval} y={yval} yexp={yref}, diff={diffr}")
+            sys.exit(1)
+        maxdiff = max(maxdiff, diffr)
+
+    print(f"Max difference from reference {maxdiff:g}")
+    sys.exit(0)
+
+if __name__ == "__main__":
+    main()
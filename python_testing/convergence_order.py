@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+import math
+import sys
+
+def read_curve(rdfile):
+    """
+    Read the (x, y) pairs of a .curve file written by heat.
+    """
+    vals = []
+    try:
+        with open(rdfile, 'r') as file:
+            for line in file:
+                if '#' in line:
+                    continue
+                parts = line.split()
+                if len(parts) < 2:
+                    continue
+                vals.append((float(parts[0]), float(parts[1])))
+    except FileNotFoundError:
+        print(f"File not found: {rdfile}")
+        sys.exit(1)
+    return vals
+
+def max_diff(coarse, fine):
+    """
+    Max difference at the coarse points of two solutions on grids that
+    differ by a factor of two in dx, so fine has a point at every coarse one.
+    """
+    if len(fine) != 2 * (len(coarse) - 1) + 1:
+        print("Grids do not differ by a factor of two")
+        sys.exit(1)
+    return max(abs(c[1] - fine[2*i][1]) for i, c in enumerate(coarse))
+
+def main():
+    """
+    Estimate the spatial order of convergence from three runs at dx, dx/2
+    and dx/4 with the same dt. The temporal error is then (nearly) the same
+    in all three, so it cancels in the differences between successive runs
+    and their ratio is 2^p for a scheme of spatial order p.
+
+    Usage: convergence_order.py <order> <dx run> <dx/2 run> <dx/4 run>
+    """
+    if len(sys.argv) < 5:
+        print("Specify expected order and three input files as arguments")
+        sys.exit(1)
+
+    expected = float(sys.argv[1])
+    runs = [read_curve(f) for f in sys.argv[2:5]]
+
+    d1 = max_diff(runs[0], runs[1])
+    d2 = max_diff(runs[1], runs[2])
+    order = math.log2(d1 / d2)
+    print(f"Differences {d1:g}, {d2:g}: observed order {order:.3f}, expected {expected:g}")
+
+    if order < expected - 0.5:
+        print("Check failed: observed order too low")
+        sys.exit(1)
+    sys.exit(0)
+
+if __name__ == "__main__":
+    main()
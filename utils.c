@@ -1,9 +1,28 @@
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdint.h>
+
 #include "heat.h"
 
 extern int Nx;
 extern Number *exact;
+extern Number *xgrid;
 extern char const *runame;
 extern int noout;
+extern int binout;
+extern Number compress;
+extern char const *grid;
+
+// Binary solution files are a small header followed by the raw array so
+// they can be mapped and copied straight into the solver's arrays
+#define HEATBIN_MAGIC "HEATBIN1"
+typedef struct _heatbin_header_t
+{
+    char magic[8];
+    int  nbytes;   // sizeof(Number) of the writer
+    int  pad;
+    long long n;   // number of values that follow
+} heatbin_header_t;
 
 // Utilities
 Number
@@ -20,6 +39,57 @@ l2_norm(int n, Number const *a, Number const *b)
     return sum / n;
 }
 
+// Estimate l2_norm from every stride-th value
+Number
+l2_norm_sampled(int n, Number const *a, Number const *b, int stride)
+{
+    int i, m = 0;
+    Number sum = 0;
+    for (i = 0; i < n; i += stride, m++)
+    {
+        Number diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum / m;
+}
+
+// Central difference weights, c[0..h], for dx^2 * d2u/dx2 of the given
+// order of accuracy. Returns the stencil half-width, h.
+int
+laplacian_stencil(int order, Number const **c)
+{
+    static Number const c2[] = {-2, 1};
+    static Number const c4[] = {-30.0/12, 16.0/12, -1.0/12};
+    static Number const c6[] = {-490.0/180, 270.0/180, -27.0/180, 2.0/180};
+
+    switch (order)
+    {
+        case 4: *c = c4; return 2;
+        case 6: *c = c6; return 3;
+    }
+    *c = c2;
+    return 1;
+}
+
+// Apply the stencil at i, using odd reflection about the end points,
+// u(-x) = 2u(0) - u(x), for samples beyond them. With fixed boundary values
+// all even derivatives of the heat equation's solution vanish there, so this
+// closure retains the order of the interior stencil.
+Number
+laplacian_at(int n, Number const *u, int i, int h, Number const *c)
+{
+    Number lap = c[0] * u[i];
+
+    for (int k = 1; k <= h; k++)
+    {
+        Number const ul = i-k < 0 ? 2*u[0] - u[k-i] : u[i-k];
+        Number const ur = i+k > n-1 ? 2*u[n-1] - u[2*(n-1)-(i+k)] : u[i+k];
+        lap += c[k] * (ul + ur);
+    }
+
+    return lap;
+}
+
 void
 copy(int n, Number *dst, Number const *src)
 {
@@ -29,6 +99,10 @@ copy(int n, Number *dst, Number const *src)
         dst[i] = src[i];
 }
 
+extern void
+write_compressed(char const *fname, int n, Number const *x, Number dx,
+    Number const *a, Number errbnd);
+
 void
 write_array(int t, int n, Number dx, Number const *a)
 {
@@ -74,18 +148,191 @@ write_array(int t, int n, Number dx, Number const *a)
     }
 
 
-    outf = fopen(fname,"w");
-    fprintf(outf, "# %s\n", vname);
+    // Optionally write solutions compressed to within compress, in place of text
+    if (compress > 0 && !strcmp(vname, "Temperature"))
+    {
+        int const uniform = !strncmp(grid, "uniform", 7);
+        char zname[128];
+
+        snprintf(zname, sizeof(zname), "%s", fname);
+        strcpy(strrchr(zname, '.'), ".heatz");
+        write_compressed(zname, n, uniform ? 0 : xgrid, dx, a, compress);
+    }
+    else
+    {
+        outf = fopen(fname,"w");
+        fprintf(outf, "# %s\n", vname);
+        for (i = 0; i < n; i++)
+            fprintf(outf, FPFMT " " FPFMT "\n",
+                t >= TFINAL ? (FPCAST) xgrid[i] : (FPCAST) i*dx, (FPCAST) a[i]);
+        fclose(outf);
+    }
+
+    // Optionally write solutions in binary too, suitable for ic="file(...)"
+    if (binout && !strcmp(vname, "Temperature"))
+    {
+        heatbin_header_t hdr;
+
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, HEATBIN_MAGIC, sizeof(hdr.magic));
+        hdr.nbytes = (int) sizeof(Number);
+        hdr.n = n;
+
+        strcpy(strrchr(fname, '.'), ".bin");
+        outf = fopen(fname,"wb");
+        fwrite(&hdr, sizeof(hdr), 1, outf);
+        fwrite(a, sizeof(Number), n, outf);
+        fclose(outf);
+    }
+}
+
+static int
+is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// A token starts at p if it is not whitespace but what precedes it is
+#define TOKEN_STARTS_AT(BUF, P) (!is_space(BUF[P]) && ((P) == 0 || is_space(BUF[(P)-1])))
+
+// Read a whitespace separated text file of values. The mapped file is cut
+// into fixed size chunks, each token belonging to the chunk it starts in.
+// Tokens are counted per chunk in parallel, a prefix sum gives each chunk
+// its offset into a and then all chunks are parsed in parallel.
+static void
+read_text_file(int n, Number *a, char const *buf, size_t size, char const *filename)
+{
+    size_t const chunk = 1<<20;
+    int const nchunks = (int) (size / chunk) + 1;
+    long long *offsets = (long long *) calloc(nchunks+1, sizeof(long long));
+    int c, bad = 0;
+
+    #pragma omp parallel for
+    for (c = 0; c < nchunks; c++)
+    {
+        size_t const end = (c+1)*chunk < size ? (c+1)*chunk : size;
+        long long count = 0;
+        for (size_t p = c*chunk; p < end; p++)
+            count += TOKEN_STARTS_AT(buf, p);
+        offsets[c+1] = count;
+    }
+
+    for (c = 0; c < nchunks; c++)
+        offsets[c+1] += offsets[c];
+
+    if (offsets[nchunks] != n)
+    {
+        fprintf(stderr, "Found %lld values in \"%s\" but need %d\n",
+            offsets[nchunks], filename, n);
+        exit(1);
+    }
+
+    #pragma omp parallel for reduction(+:bad)
+    for (c = 0; c < nchunks; c++)
+    {
+        size_t const end = (c+1)*chunk < size ? (c+1)*chunk : size;
+        long long i = offsets[c];
+        for (size_t p = c*chunk; p < end; p++)
+        {
+            char tok[64], *ep;
+            size_t len = 0;
+
+            if (!TOKEN_STARTS_AT(buf, p))
+                continue;
+
+            // The mapped file is not nul terminated so copy the token out
+            while (p+len < size && !is_space(buf[p+len]) && len < sizeof(tok)-1)
+            {
+                tok[len] = buf[p+len];
+                len++;
+            }
+            tok[len] = '\0';
+
+            a[i++] = (Number) strtod(tok, &ep);
+            bad += *ep != '\0' || (p+len < size && !is_space(buf[p+len]));
+        }
+    }
+
+    free(offsets);
+
+    if (bad)
+    {
+        fprintf(stderr, "Found %d invalid values in \"%s\"\n", bad, filename);
+        exit(1);
+    }
+}
+
+// Copy a binary solution file written with binout=1 into a
+static void
+read_binary_file(int n, Number *a, char const *buf, size_t size, char const *filename)
+{
+    heatbin_header_t hdr;
+    int i;
+
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.nbytes != (int) sizeof(Number) || hdr.n != n ||
+        size < sizeof(hdr) + n * sizeof(Number))
+    {
+        fprintf(stderr, "Binary file \"%s\" has %lld values of %d bytes but need %d of %d bytes\n",
+            filename, hdr.n, hdr.nbytes, n, (int) sizeof(Number));
+        exit(1);
+    }
+
+    #pragma omp parallel for
     for (i = 0; i < n; i++)
-        fprintf(outf, FPFMT " " FPFMT "\n", (FPCAST) i*dx, (FPCAST) a[i]);
-    fclose(outf);
+        memcpy(&a[i], buf + sizeof(hdr) + i * sizeof(Number), sizeof(Number));
+}
+
+static void
+read_file(int n, Number *a, char const *filename)
+{
+    struct stat st;
+    char const *buf = 0;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st))
+    {
+        fprintf(stderr, "Unable to open initial condition file \"%s\"\n", filename);
+        exit(1);
+    }
+
+    if (st.st_size > 0)
+    {
+        buf = (char const *) mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        assert(buf != MAP_FAILED);
+    }
+
+    if (st.st_size >= (off_t) sizeof(heatbin_header_t) &&
+        !memcmp(buf, HEATBIN_MAGIC, strlen(HEATBIN_MAGIC)))
+        read_binary_file(n, a, buf, st.st_size, filename);
+    else
+        read_text_file(n, a, buf, st.st_size, filename);
+
+    if (buf)
+        munmap((void*) buf, st.st_size);
+    close(fd);
+}
+
+// Philox2x32-10 counter-based generator (Salmon et al., SC'11). The output
+// depends only on (key, counter), so every grid index can be filled
+// independently and in parallel with identical results for any nt.
+static inline uint64_t
+philox2x32(uint32_t key, uint32_t ctr0, uint32_t ctr1)
+{
+    for (int r = 0; r < 10; r++)
+    {
+        uint64_t const prod = (uint64_t) 0xD256D193 * ctr0;
+        ctr0 = (uint32_t) (prod >> 32) ^ key ^ ctr1;
+        ctr1 = (uint32_t) prod;
+        key += 0x9E3779B9;
+    }
+    return ((uint64_t) ctr0 << 32) | ctr1;
 }
 
 void
 set_initial_condition(int n, Number *a, Number dx, char const *ic)
 {
     int i;
-    double x;
 
     if (!strncmp(ic, "const(", 6)) /* const(val) */
     {
@@ -99,10 +346,10 @@ set_initial_condition(int n, Number *a, Number dx, char const *ic)
         double left = strtod(ic+5, &p);
         double xmid = strtod(p+1, &p);
         double right = strtod(p+1, 0);
-        for (i = 0, x = 0; i < n; i++, x+=dx)
+        for (i = 0; i < n; i++)
         {
-            if (x < xmid) a[i] = left;
-            else          a[i] = right;
+            if (xgrid[i] < xmid) a[i] = left;
+            else                 a[i] = right;
         }
     }
     else if (!strncmp(ic, "ramp(", 5)) /* ramp(left,right) */
@@ -110,35 +357,37 @@ set_initial_condition(int n, Number *a, Number dx, char const *ic)
         char *p;
         double left = strtod(ic+5, &p);
         double right = strtod(p+1, 0);
-        double dv = (right-left)/(n-1);
-        for (i = 0, x = left; i < n; i++, x+=dv)
-            a[i] = x;
+        for (i = 0; i < n; i++)
+            a[i] = left + (right-left) * xgrid[i] / xgrid[n-1];
     }
     else if (!strncmp(ic, "rand(", 5)) /* rand(seed,base,amp) */
     {
         char *p, *ep;
-        int seed = (int) strtol(ic+5,&p,10);
+        uint32_t seed = (uint32_t) strtol(ic+5,&p,10);
         double base = strtod(p+1, &p);
         double amp = strtod(p+1, 0);
-        const double maxr = ((long long)1<<31)-1;
-        srandom(seed);
+        #pragma omp parallel for simd
         for (i = 0; i < n; i++)
-            a[i] = base + amp * (2*random()/maxr - 1);
+        {
+            // top 53 bits of the i-th random number to a double in [0,1)
+            double u = (philox2x32(seed, (uint32_t) i, 0) >> 11) * 0x1.0p-53;
+            a[i] = base + amp * (2*u - 1);
+        }
     }
     else if (!strncmp(ic, "sin(", 4)) /* A*sin(PI*w*x) */
     {
         char *p;
         double amp = strtod(ic+4,&p);
         double w = strtod(p+1, 0);
-        for (i = 0, x = 0; i < n; i++, x+=dx)
-            a[i] = amp * sin(M_PI*w*x);
+        for (i = 0; i < n; i++)
+            a[i] = amp * sin(M_PI*w*xgrid[i]);
     }
     else if (!strncmp(ic, "spikes(", 7)) /* spikes(Const,Amp,Loc,Amp,Loc,...) */
     {
         char *next;
         double cval = strtod(ic+7, &next);
         char const *p = next;
-        for (i = 0, x = 0; i < n; i++)
+        for (i = 0; i < n; i++)
             a[i] = cval;
         while (*p != ')')
         {
@@ -152,28 +401,12 @@ set_initial_condition(int n, Number *a, Number dx, char const *ic)
     }
     else if (!strncmp(ic, "file(", 5)) /* file(numbers.dat) */
     {
-        FILE *icfile;
         char *filename = strdup(&ic[5]);
         char *parenchar  = strchr(filename, ')');
-        double val;
 
-        /* open the file */
         assert(parenchar);
         *parenchar = '\0';
-        icfile = fopen(filename, "r");
-        assert(icfile);
-
-        /* read the data */
-        for (i = 0; (fscanf(icfile, "%lg", &val) == 1) && (i<n); i++)
-            a[i] = val;
-
-        /* sanity checks */
-        assert(!ferror(icfile));
-        assert(feof(icfile));
-        assert(i==n);
-
-        /* cleanup */
-        fclose(icfile);
+        read_file(n, a, filename);
         free(filename);
     }
     write_array(TSTART, Nx, dx, a);